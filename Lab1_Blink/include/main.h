@@ -2,6 +2,7 @@
 #define MAIN_H_
 
 #include <Arduino.h>
+#include <LoopProfiler.h>
 
 gpio_num_t  LED_B        = GPIO_NUM_18 ;         // Blue LED Delays
 uint16_t    DELAY_ON_B   = 2000 ;
@@ -11,6 +12,12 @@ gpio_num_t  LED_R        = GPIO_NUM_16 ;         // Red LED Delays
 uint16_t    DELAY_ON_R   = 3000 ;
 uint16_t    DELAY_OFF_R  = 2000 ;
 
+uint32_t    PHASE_SLACK_US  = 20000 ;           // delay() overrun allowed per blink phase
+uint32_t    BLUE_BUDGET_US  = (DELAY_ON_B + DELAY_OFF_B) * 1000UL + PHASE_SLACK_US ;
+uint32_t    RED_BUDGET_US   = (DELAY_ON_R + DELAY_OFF_R) * 1000UL + PHASE_SLACK_US ;
+uint32_t    LOOP_BUDGET_US  = BLUE_BUDGET_US + RED_BUDGET_US ;
+uint32_t    LOOP_WATCHDOG_S = 15 ;
+
 typedef enum {                                  // Enumerated type
   LED_ON  = LOW ,                               // LEDs are active LOW
   LED_OFF = HIGH
@@ -18,6 +25,7 @@ typedef enum {                                  // Enumerated type
 
 LED_State_t blueLED_state ;                     // Declare variables of type LED_State_t
 LED_State_t redLED_state ;
+uint32_t    stallsReported ;                    // profile.overBudget at the last dump
 
 /* Function prototypes */
 void blinkBlueLED(void) ;
@@ -13,12 +13,25 @@
 void setup() {                                  // Configure LEDs as output
   pinMode(LED_B, OUTPUT) ;
   pinMode(LED_R, OUTPUT) ;
+  profiler_init(LOOP_BUDGET_US, LOOP_WATCHDOG_S) ;
 }
 
 /* MAIN */ 
 void loop() {
-    blinkBlueLED() ;                            // Turn blue LED on and off
-    blinkRedLED() ;                             // Turn red LED on and off
+    profiler_loop_begin() ;
+    {
+        PROFILE_SCOPE_BUDGET("blinkBlueLED", BLUE_BUDGET_US) ;
+        blinkBlueLED() ;                        // Turn blue LED on and off
+    }
+    {
+        PROFILE_SCOPE_BUDGET("blinkRedLED", RED_BUDGET_US) ;
+        blinkRedLED() ;                         // Turn red LED on and off
+    }
+    profiler_loop_end() ;
+    if (profile.overBudget != stallsReported) { // Histogram and worst stalls, only
+        stallsReported = profile.overBudget ;   // when a phase or the cycle overran
+        profiler_dump() ;
+    }
 }
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 /* Function Definitions */
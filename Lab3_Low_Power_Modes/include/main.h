@@ -2,6 +2,14 @@
 #define MAIN_H_
 
 #include <Arduino.h>
+#include <Telemetry.h>
+#include <RgbLed.h>
+#include <LoopProfiler.h>
+#include <BootTiming.h>
+#include <KeyMatrix.h>
+#include <TouchInput.h>
+#include <BatteryGovernor.h>
+#include <AllocTracker.h>
 
 #if !defined(ESP32) && !defined(MSP432401R)
     #warning "No macros defined."
@@ -9,6 +17,10 @@
 
 /* TARGET SELECTION */
 #if !defined(MSP432401R)
+    #include <esp_timer.h>
+    #include <driver/pcnt.h>
+    #include <hal/gpio_ll.h>
+
     /* ESP32 PINS */
     // uint8_t const LED2_B        = 19 ;
     // uint8_t const LED1_B        = 18 ;
@@ -34,7 +46,30 @@
     //     uint8_t  count ;
     // } Button_t ;
 
+    /* BUTTON INPUT MODE */
+    #define BUTTON_MASK_AND_REARM   (1)                                                             // Accept the first edge, mask the pin, re-enable once released and settled
+    #define BUTTON_PCNT_UNIT        (PCNT_UNIT_0)                                                   // Counts every BUTTON1 edge in hardware, masked or not
+
+    /* LED1 OUTPUT MODE */
+    #define RGB_LED_FADE            (1)                                                             // Drive LED1 from LEDC with gamma-corrected fades
+
+    /* KEY MATRIX INPUT */
+    // #define KEY_MATRIX_INPUT     (1)                                                             // Key downs on the matrix count as BUTTON1 presses;
+                                                                                                    // opt-in (env:esp32dev_keymatrix) so unwired boards keep the pins
+    uint8_t const KEY_ROWS[]       = { 21, 22, 23, 25 } ;                                       // Open-drain outputs
+    uint8_t const KEY_COLS[]       = { 26, 27, 32, 33 } ;                                       // Inputs with pull-ups; add pins for more keys
+
+    /* TOUCH INPUT */
+    // #define TOUCH_INPUT          (1)                                                             // Touch pads press like BUTTON1 and wake from sleep;
+                                                                                                    // opt-in (env:esp32dev_touch), bare pads read as noise
+    touch_pad_t const TOUCH_PADS[] = { TOUCH_PAD_NUM4, TOUCH_PAD_NUM6 } ;                       // GPIO 13 and GPIO 14
+
+    /* BATTERY GOVERNOR */
+    // #define BATTERY_GOVERNOR     (1)                                                             // Supply on GPIO 34 through a 1:2 divider; opt-in
+                                                                                                    // (env:esp32dev_battery), a bare pin floats
+
     void IRAM_ATTR ISR_buttonPressed(void) ;
+    void button_rearm(void *arg) ;
 #else
     /* MSP432 PINS */
     uint8_t const LED2_B        = 78 ;                                                          // LED2_B is actually yellow on MSP432
@@ -60,6 +95,18 @@
 uint32_t const BUTTON_DEBOUNCE  = 350 ;
 uint32_t const BLINK1_DELAY     = 50 ;
 uint32_t const BLINK2_DELAY     = 1000 ;
+uint32_t const RGB_FADE_TIME    = 250 ;                                                         // ms for LED1 color transitions
+uint32_t const LOOP_BUDGET_US   = 20000 ;                                                       // loop() iterations slower than this are stalls;
+                                                                                                // time in light sleep counts
+uint32_t const LOOP_WATCHDOG_S  = 5 ;                                                           // Stall long enough to reset and dump the profile
+uint32_t const TOUCH_INTERVAL   = 50 ;                                                          // ms between touch measurements, awake and asleep:
+                                                                                                // longer sleeps lighter, shorter wakes faster
+
+#ifdef RGB_LED_FADE
+Rgb_t const    RGB_OFF          = {   0,   0,   0 } ;
+Rgb_t const    RGB_BLUE         = {   0,   0, 255 } ;
+Rgb_t const    RGB_RED          = { 255,   0,   0 } ;
+#endif
 
 /* LOW POWER VARIALBES AND CONSTANTS */
 // uint64_t const              BUTTON1_MASK = 1L << 0 ;                                             // Button is pin 0, but we need it ON; used for ext1
@@ -73,11 +120,16 @@ LED_State_t static          redLED_state ;
 
 uint8_t static volatile     buttonCount ;
 // Button_t static             buttonCount ;
+bool static volatile        buttonPressPending ;                                                // Set by the ISR, counted and reported in loop()
+uint32_t static volatile    buttonEdgesAccepted ;                                               // Edges that counted as a press
+uint32_t static volatile    buttonEdgesSuppressed ;                                             // Bounce edges that never reached the ISR
+esp_timer_handle_t          buttonRearmTimer ;                                                  // One-shot timer that unmasks the button interrupt
 
 uint32_t                    currentMillis ;
 uint32_t                    previousMillis_Btn ;
 uint32_t                    previousMillis_Blink1 ;
 uint32_t                    previousMillis_Blink2 ;
+uint32_t                    previousMillis_Press ;                                              // Last press, for the battery governor's idle sleep
 
 
 /* Function Prototypes */
@@ -87,6 +139,9 @@ void change_to_state1(void) ;
 void change_to_state2(uint32_t currentMillis) ;
 void change_to_state3() ;
 void change_to_state4() ;
+void button_init(void) ;
+HardwareSerial &console(void) ;
+void console_printf(char const *format, ...) __attribute__((format(printf, 1, 2))) ;
 // void IRAM_ATTR ISR_buttonPressed(void) ;
 
 
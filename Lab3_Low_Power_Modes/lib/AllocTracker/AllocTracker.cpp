@@ -0,0 +1,251 @@
+/*
+ * Name: AllocTracker
+ * Description: See AllocTracker.h. The wrappers sit in front of the heap for
+ *              every caller in the image, including ones that run with the
+ *              flash cache off, so they and everything they touch stay in
+ *              IRAM/DRAM and they print with the ROM's ets_printf().
+ *
+ *              In IDF 4.4 newlib's allocators are one-line forwards to
+ *              heap_caps_malloc_default() and heap_caps_realloc_default(),
+ *              which are wrapped as well, and the _prefer allocators loop
+ *              over heap_caps_malloc(), calloc() and realloc(). Those
+ *              wrappers therefore do the same steps on the unwrapped
+ *              functions themselves, or every call would be recorded twice.
+ *              The remaining heap_caps_* functions only call each other
+ *              inside one file, where --wrap does not reach.
+ */
+
+#include "AllocTracker.h"
+
+/* State Variables */
+AllocTracker_t              alloc_tracker ;
+
+#ifdef ALLOC_TRACKER
+#include <esp_heap_caps.h>
+#include <esp_timer.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/reent.h>
+
+static portMUX_TYPE         trackerLock = portMUX_INITIALIZER_UNLOCKED ;
+static uint32_t             reported ;                                                          // Records already printed
+
+extern "C" {
+    void   *__real_heap_caps_malloc(size_t size, uint32_t caps) ;
+    void   *__real_heap_caps_calloc(size_t count, size_t size, uint32_t caps) ;
+    void   *__real_heap_caps_realloc(void *pointer, size_t size, uint32_t caps) ;
+    void   *__real_heap_caps_malloc_default(size_t size) ;
+    void   *__real_heap_caps_realloc_default(void *pointer, size_t size) ;
+    void   *__real_heap_caps_aligned_alloc(size_t alignment, size_t size, uint32_t caps) ;
+    void   *__real_heap_caps_aligned_calloc(size_t alignment, size_t count, size_t size, uint32_t caps) ;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/* Function Definitions */
+
+static void IRAM_ATTR record(Alloc_Kind_t kind, size_t size, void *caller) {                   // One ring entry per allocation once armed
+    if (!alloc_tracker.armed) {
+        return ;
+    }
+    portENTER_CRITICAL_SAFE(&trackerLock) ;
+    AllocRecord_t *entry = &alloc_tracker.records[alloc_tracker.count % ALLOC_TRACKER_RECORDS] ;
+    entry->caller   = caller ;
+    entry->size     = size ;
+    entry->at_ms    = esp_timer_get_time() / 1000 ;
+    entry->kind     = kind ;
+    alloc_tracker.count++ ;
+    alloc_tracker.bytes += size ;
+    portEXIT_CRITICAL_SAFE(&trackerLock) ;
+
+    #ifdef ALLOC_TRACKER_STRICT
+    ets_printf(DRAM_STR("\nheap allocation after setup(): %u bytes from %p\n"), size, caller) ;
+    abort() ;                                                                                   // Backtrace below shows the whole call chain
+    #endif
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void * IRAM_ATTR calloc_default(size_t count, size_t size, Alloc_Kind_t kind, void *caller) {
+    size_t  bytes ;                                                                             // Same steps as newlib's _calloc_r()
+    void   *pointer ;
+
+    if (__builtin_mul_overflow(count, size, &bytes)) {
+        return NULL ;
+    }
+    record(kind, bytes, caller) ;
+    pointer = __real_heap_caps_malloc_default(bytes) ;
+    if (pointer != NULL) {
+        memset(pointer, 0, bytes) ;
+    }
+    return pointer ;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+extern "C" void * IRAM_ATTR __wrap_malloc(size_t size) {
+    record(ALLOC_MALLOC, size, __builtin_return_address(0)) ;
+    return __real_heap_caps_malloc_default(size) ;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+extern "C" void * IRAM_ATTR __wrap__malloc_r(struct _reent *reent, size_t size) {              // newlib's own callers (stdio, strdup) use this
+    record(ALLOC_MALLOC_R, size, __builtin_return_address(0)) ;
+    return __real_heap_caps_malloc_default(size) ;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+extern "C" void * IRAM_ATTR __wrap_calloc(size_t count, size_t size) {
+    return calloc_default(count, size, ALLOC_CALLOC, __builtin_return_address(0)) ;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+extern "C" void * IRAM_ATTR __wrap__calloc_r(struct _reent *reent, size_t count, size_t size) {
+    return calloc_default(count, size, ALLOC_CALLOC_R, __builtin_return_address(0)) ;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+extern "C" void * IRAM_ATTR __wrap_realloc(void *pointer, size_t size) {                        // Shrinking counts too: it is still the heap
+    record(ALLOC_REALLOC, size, __builtin_return_address(0)) ;
+    return __real_heap_caps_realloc_default(pointer, size) ;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+extern "C" void * IRAM_ATTR __wrap__realloc_r(struct _reent *reent, void *pointer, size_t size) {
+    record(ALLOC_REALLOC_R, size, __builtin_return_address(0)) ;
+    return __real_heap_caps_realloc_default(pointer, size) ;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+extern "C" void * IRAM_ATTR __wrap_heap_caps_malloc(size_t size, uint32_t caps) {               // FreeRTOS objects and IDF drivers allocate here
+    record(ALLOC_HEAP_CAPS, size, __builtin_return_address(0)) ;
+    return __real_heap_caps_malloc(size, caps) ;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+extern "C" void * IRAM_ATTR __wrap_heap_caps_calloc(size_t count, size_t size, uint32_t caps) {
+    record(ALLOC_HEAP_CAPS_CALLOC, count * size, __builtin_return_address(0)) ;
+    return __real_heap_caps_calloc(count, size, caps) ;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+extern "C" void * IRAM_ATTR __wrap_heap_caps_realloc(void *pointer, size_t size, uint32_t caps) {
+    record(ALLOC_HEAP_CAPS_REALLOC, size, __builtin_return_address(0)) ;
+    return __real_heap_caps_realloc(pointer, size, caps) ;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+extern "C" void * IRAM_ATTR __wrap_heap_caps_malloc_default(size_t size) {                      // Direct IDF callers; newlib's are counted above
+    record(ALLOC_HEAP_CAPS_DEFAULT, size, __builtin_return_address(0)) ;
+    return __real_heap_caps_malloc_default(size) ;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+extern "C" void * IRAM_ATTR __wrap_heap_caps_realloc_default(void *pointer, size_t size) {
+    record(ALLOC_HEAP_CAPS_REALLOC_DEFAULT, size, __builtin_return_address(0)) ;
+    return __real_heap_caps_realloc_default(pointer, size) ;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+extern "C" void * IRAM_ATTR __wrap_heap_caps_aligned_alloc(size_t alignment, size_t size, uint32_t caps) {
+    record(ALLOC_HEAP_CAPS_ALIGNED, size, __builtin_return_address(0)) ;
+    return __real_heap_caps_aligned_alloc(alignment, size, caps) ;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+extern "C" void * IRAM_ATTR __wrap_heap_caps_aligned_calloc(size_t alignment, size_t count, size_t size, uint32_t caps) {
+    record(ALLOC_HEAP_CAPS_ALIGNED_CALLOC, count * size, __builtin_return_address(0)) ;
+    return __real_heap_caps_aligned_calloc(alignment, count, size, caps) ;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+extern "C" void * IRAM_ATTR __wrap_heap_caps_malloc_prefer(size_t size, size_t num, ...) {     // Tries each caps in turn, like the IDF's own
+    void   *pointer = NULL ;
+    va_list caps ;
+
+    record(ALLOC_HEAP_CAPS_PREFER, size, __builtin_return_address(0)) ;
+    va_start(caps, num) ;
+    while ( (pointer == NULL) && num-- ) {
+        pointer = __real_heap_caps_malloc(size, va_arg(caps, uint32_t)) ;
+    }
+    va_end(caps) ;
+    return pointer ;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+extern "C" void * IRAM_ATTR __wrap_heap_caps_calloc_prefer(size_t count, size_t size, size_t num, ...) {
+    void   *pointer = NULL ;
+    va_list caps ;
+
+    record(ALLOC_HEAP_CAPS_CALLOC_PREFER, count * size, __builtin_return_address(0)) ;
+    va_start(caps, num) ;
+    while ( (pointer == NULL) && num-- ) {
+        pointer = __real_heap_caps_calloc(count, size, va_arg(caps, uint32_t)) ;
+    }
+    va_end(caps) ;
+    return pointer ;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+extern "C" void * IRAM_ATTR __wrap_heap_caps_realloc_prefer(void *pointer, size_t size, size_t num, ...) {
+    void   *result = NULL ;
+    va_list caps ;
+
+    record(ALLOC_HEAP_CAPS_REALLOC_PREFER, size, __builtin_return_address(0)) ;
+    va_start(caps, num) ;
+    while ( (result == NULL) && num-- ) {
+        result = __real_heap_caps_realloc(pointer, size, va_arg(caps, uint32_t)) ;
+    }
+    va_end(caps) ;
+    return result ;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void alloc_tracker_arm(void) {
+    alloc_tracker.armed = true ;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void __attribute__((format(printf, 2, 3))) report_printf(Print &out, char const *format, ...) {
+    static char buffer[128] ;                                                                   // Print::printf() would malloc for lines of 64
+    va_list     args ;                                                                          // characters or more, and the report would then
+                                                                                                // record allocations of its own.
+    va_start(args, format) ;
+    int const length = vsnprintf(buffer, sizeof(buffer), format, args) ;
+    va_end(args) ;
+    if (length > 0) {
+        out.write((uint8_t const *)buffer, min((size_t)length, sizeof(buffer) - 1)) ;
+    }
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void alloc_tracker_report(Print &out) {                                                         // Call from loop(); silent while nothing new
+    static char const *const kinds[] = { "malloc", "calloc", "realloc", "heap_caps_malloc", "_malloc_r",
+                                         "heap_caps_calloc", "heap_caps_realloc", "heap_caps_malloc_default",
+                                         "_calloc_r", "_realloc_r", "heap_caps_realloc_default",
+                                         "heap_caps_aligned_alloc", "heap_caps_aligned_calloc",
+                                         "heap_caps_malloc_prefer", "heap_caps_calloc_prefer",
+                                         "heap_caps_realloc_prefer" } ;
+    static_assert(sizeof(kinds) / sizeof(kinds[0]) == ALLOC_HEAP_CAPS_REALLOC_PREFER + 1, "one name per Alloc_Kind_t") ;
+    uint32_t const count = alloc_tracker.count ;
+
+    if (count == reported) {
+        return ;
+    }
+    if (count - reported > ALLOC_TRACKER_RECORDS) {                                             // Ring wrapped: older ones are gone
+        report_printf(out, "alloc tracker: %u records lost\n", count - reported - ALLOC_TRACKER_RECORDS) ;
+        reported = count - ALLOC_TRACKER_RECORDS ;
+    }
+    for ( ; reported < count ; reported++) {
+        AllocRecord_t const entry = alloc_tracker.records[reported % ALLOC_TRACKER_RECORDS] ;
+        report_printf(out, "alloc #%u at %u ms: %s(%u) from %p\n", reported + 1, entry.at_ms, kinds[entry.kind],
+                      entry.size, entry.caller) ;
+    }
+    report_printf(out, "alloc tracker: %u allocations, %u bytes since setup()\n", count, alloc_tracker.bytes) ;
+}
+#else
+void alloc_tracker_arm(void) {                                                                  // Nothing is wrapped, nothing to track
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void alloc_tracker_report(Print &out) {
+}
+#endif
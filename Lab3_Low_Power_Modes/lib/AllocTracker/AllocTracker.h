@@ -0,0 +1,71 @@
+/*
+ * Name: AllocTracker
+ * Description: Proves the steady-state loop never touches the heap. With
+ *              ALLOC_TRACKER defined and the allocators wrapped at link time
+ *              (-Wl,--wrap for newlib's malloc, calloc, realloc, _malloc_r,
+ *              _calloc_r and _realloc_r, and for every heap_caps_* allocator
+ *              FreeRTOS and the IDF use: plain, _default, _aligned and
+ *              _prefer, each in its malloc, calloc and realloc form), every
+ *              allocation made after alloc_tracker_arm() is counted and the
+ *              latest ALLOC_TRACKER_RECORDS are kept with their caller's
+ *              address (feed it to xtensa-esp32-elf-addr2line).
+ *
+ *              ALLOC_TRACKER_STRICT turns the first such allocation into an
+ *              abort() at runtime: an esp32dev_alloccheck image that reaches
+ *              an allocating path in loop() panics on the spot with the
+ *              allocating call in the backtrace. The build itself cannot
+ *              catch it, so run that image through every state.
+ *
+ *              Without ALLOC_TRACKER the library compiles to nothing.
+ * Target: Espressif ESP32 dev board
+ */
+
+#ifndef ALLOC_TRACKER_H_
+#define ALLOC_TRACKER_H_
+
+#include <Arduino.h>
+
+/* Configuration */
+#define ALLOC_TRACKER_RECORDS   (16)
+
+/* Enumerations and Structures */
+typedef enum {
+    ALLOC_MALLOC ,
+    ALLOC_CALLOC ,
+    ALLOC_REALLOC ,
+    ALLOC_HEAP_CAPS ,                                                                           // heap_caps_malloc
+    ALLOC_MALLOC_R ,
+    ALLOC_HEAP_CAPS_CALLOC ,
+    ALLOC_HEAP_CAPS_REALLOC ,
+    ALLOC_HEAP_CAPS_DEFAULT ,                                                                   // heap_caps_malloc_default
+    ALLOC_CALLOC_R ,
+    ALLOC_REALLOC_R ,
+    ALLOC_HEAP_CAPS_REALLOC_DEFAULT ,
+    ALLOC_HEAP_CAPS_ALIGNED ,                                                                   // heap_caps_aligned_alloc
+    ALLOC_HEAP_CAPS_ALIGNED_CALLOC ,
+    ALLOC_HEAP_CAPS_PREFER ,                                                                    // heap_caps_malloc_prefer
+    ALLOC_HEAP_CAPS_CALLOC_PREFER ,
+    ALLOC_HEAP_CAPS_REALLOC_PREFER
+} Alloc_Kind_t ;
+
+typedef struct {
+    void       *caller ;                                                                        // Return address in the allocating function
+    uint32_t    size ;
+    uint32_t    at_ms ;
+    uint8_t     kind ;                                                                          // Alloc_Kind_t
+} AllocRecord_t ;
+
+typedef struct {
+    bool            armed ;
+    uint32_t        count ;                                                                     // Allocations since alloc_tracker_arm()
+    uint32_t        bytes ;
+    AllocRecord_t   records[ALLOC_TRACKER_RECORDS] ;                                            // Ring, indexed by count
+} AllocTracker_t ;
+
+extern AllocTracker_t alloc_tracker ;
+
+/* Function Prototypes */
+void    alloc_tracker_arm(void) ;                                                               // Last line of setup()
+void    alloc_tracker_report(Print &out) ;                                                      // Prints records not yet reported
+
+#endif /* ALLOC_TRACKER_H_ */
@@ -0,0 +1,151 @@
+/*
+ * Name: BatteryGovernor
+ * Description: See BatteryGovernor.h. The governor is plain C so the host
+ *              tools can drive it with a simulated discharge; the ADC half
+ *              only exists on the ESP32, where continuous mode runs ADC1
+ *              through I2S0 and its DMA.
+ */
+
+#include "BatteryGovernor.h"
+
+#ifdef ARDUINO
+    #include <Arduino.h>
+    #include <driver/adc.h>
+    #include <esp_adc_cal.h>
+
+    #define BATTERY_ADC_CHANNEL     (ADC1_CHANNEL_6)                                            // GPIO 34
+    #define BATTERY_FRAME_BYTES     (BATTERY_FRAME_SAMPLES * SOC_ADC_DIGI_RESULT_BYTES)
+
+    /* State Variables */
+    Battery_Governor_t              battery ;
+    Battery_Config_t const          battery_config = BATTERY_CONFIG_DEFAULT ;
+
+    static esp_adc_cal_characteristics_t    adcChars ;
+    static uint8_t                          frame[BATTERY_FRAME_BYTES] ;
+    static bool                             sampling ;
+    static uint32_t                         previousMillis_Battery ;
+#endif
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/* Function Definitions */
+
+Battery_Level_t battery_governor_update(Battery_Governor_t *governor, Battery_Config_t const *config, uint16_t reading_mV) {
+    if ( (reading_mV < config->validMin_mV) || (reading_mV > config->validMax_mV) ) {           // Not a cell: keep the level, don't act on it
+        governor->rejected++ ;
+        return governor->level ;
+    }
+    if (governor->mV == 0) {                                                                    // First reading seeds the filter
+        governor->filtered_q4 = (uint32_t)reading_mV << 4 ;
+    }
+    else {
+        int32_t const error = ((int32_t)reading_mV << 4) - (int32_t)governor->filtered_q4 ;
+        governor->filtered_q4 += error >> config->filterShift ;
+    }
+    governor->mV = governor->filtered_q4 >> 4 ;
+
+    uint16_t const  mV      = governor->mV ;                                                    // Down as soon as a threshold is crossed, up
+    Battery_Level_t level   = governor->level ;                                                 // only with hysteresis_mV to spare.
+    if (mV < config->critical_mV) {
+        level = BATTERY_CRITICAL ;
+    }
+    else if (level == BATTERY_NORMAL && mV < config->low_mV) {
+        level = BATTERY_LOW ;
+    }
+    else if (level == BATTERY_CRITICAL && mV >= config->critical_mV + config->hysteresis_mV) {
+        level = BATTERY_LOW ;
+    }
+    if (level == BATTERY_LOW && mV >= config->low_mV + config->hysteresis_mV) {                 // A charger can lift it straight to NORMAL
+        level = BATTERY_NORMAL ;
+    }
+
+    if (level != governor->level) {
+        governor->level = level ;
+        governor->transitions++ ;
+    }
+    return level ;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+Battery_Action_t battery_governor_decide(Battery_Governor_t *governor, Battery_Config_t const *config, uint32_t idle_ms) {
+    if      (governor->level == BATTERY_CRITICAL)   governor->action = BATTERY_ACTION_DEEP_SLEEP ;          // idle_ms: time since the last press
+    else if (governor->level == BATTERY_NORMAL)     governor->action = BATTERY_ACTION_NONE ;
+    else if (idle_ms >= config->idleSleep_ms)       governor->action = BATTERY_ACTION_LIGHT_SLEEP ;
+    else                                            governor->action = BATTERY_ACTION_SHORT_ON ;
+    return governor->action ;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+uint32_t battery_on_time(Battery_Level_t level, uint32_t on_ms) {                               // LED on-time for the level, never 0 ms
+    uint32_t const scaled = (level == BATTERY_NORMAL) ? on_ms : on_ms >> (uint32_t)level ;
+    return (scaled > 0) ? scaled : 1 ;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifdef ARDUINO
+void battery_init(void) {                                                                       // Sets up ADC1 continuous mode on one channel;
+    adc_digi_init_config_t const initConfig = {                                                 // it only runs while a frame is wanted.
+        .max_store_buf_size = 2 * BATTERY_FRAME_BYTES,
+        .conv_num_each_intr = BATTERY_FRAME_BYTES,
+        .adc1_chan_mask     = BIT(BATTERY_ADC_CHANNEL),
+        .adc2_chan_mask     = 0
+    } ;
+    adc_digi_pattern_config_t pattern = {
+        .atten              = ADC_ATTEN_DB_11,                                                  // ~150 - 2450 mV at the pin
+        .channel            = BATTERY_ADC_CHANNEL,
+        .unit               = 0,                                                                // ADC1
+        .bit_width          = SOC_ADC_DIGI_MAX_BITWIDTH
+    } ;
+    adc_digi_configuration_t const digiConfig = {
+        .conv_limit_en      = true,                                                             // Required on the ESP32
+        .conv_limit_num     = 250,
+        .pattern_num        = 1,
+        .adc_pattern        = &pattern,
+        .sample_freq_hz     = BATTERY_SAMPLE_HZ,
+        .conv_mode          = ADC_CONV_SINGLE_UNIT_1,
+        .format             = ADC_DIGI_OUTPUT_FORMAT_TYPE1
+    } ;
+    adc_digi_initialize(&initConfig) ;
+    adc_digi_controller_configure(&digiConfig) ;
+    esp_adc_cal_characterize(ADC_UNIT_1, ADC_ATTEN_DB_11, ADC_WIDTH_BIT_12, 1100, &adcChars) ;
+
+    adc_digi_start() ;                                                                          // First reading as soon as possible
+    sampling                = true ;
+    previousMillis_Battery  = millis() ;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool battery_service(uint32_t currentMillis) {                                                  // Call every loop(). Starts the ADC once per
+    uint32_t length     = 0 ;                                                                   // period and collects the frame on a later call,
+    uint32_t sum        = 0 ;                                                                   // so it never waits on the DMA.
+    uint32_t samples    = 0 ;
+
+    if (!sampling) {
+        if ( (currentMillis - previousMillis_Battery) >= BATTERY_PERIOD ) {
+            previousMillis_Battery += BATTERY_PERIOD ;
+            adc_digi_start() ;
+            sampling = true ;
+        }
+        return false ;
+    }
+    if (adc_digi_read_bytes(frame, sizeof(frame), &length, 0) != ESP_OK || length == 0) {
+        return false ;                                                                          // Frame not finished yet
+    }
+    adc_digi_stop() ;
+    sampling = false ;
+
+    for (uint32_t i = 0 ; i + SOC_ADC_DIGI_RESULT_BYTES <= length ; i += SOC_ADC_DIGI_RESULT_BYTES) {
+        adc_digi_output_data_t const *result = (adc_digi_output_data_t const *)&frame[i] ;
+        if (result->type1.channel == BATTERY_ADC_CHANNEL) {
+            sum += result->type1.data ;
+            samples++ ;
+        }
+    }
+    if (samples == 0) {
+        return false ;
+    }
+    uint32_t const pin_mV   = esp_adc_cal_raw_to_voltage(sum / samples, &adcChars) ;
+    uint32_t const rejected = battery.rejected ;
+    battery_governor_update(&battery, &battery_config, pin_mV * BATTERY_DIVIDER) ;
+    return battery.rejected == rejected ;
+}
+#endif
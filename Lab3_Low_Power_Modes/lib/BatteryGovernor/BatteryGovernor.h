@@ -0,0 +1,88 @@
+/*
+ * Name: BatteryGovernor
+ * Description: Supply voltage monitor and the power policy that follows it.
+ *              Every BATTERY_PERIOD ms the ADC is started in continuous mode
+ *              and the DMA fills one frame of BATTERY_FRAME_SAMPLES readings
+ *              on its own; the frame is averaged into a single reading (the
+ *              decimation) and the ADC is stopped again until the next period.
+ *
+ *              Readings outside validMin_mV - validMax_mV cannot come from a
+ *              connected cell (an open divider leaves GPIO 34 floating) and
+ *              are counted and dropped before they reach the filter.
+ *
+ *              The governor smooths the readings with a 1/2^filterShift IIR
+ *              and moves between levels with hysteresis, so LED load dips
+ *              and ADC noise cannot make it flap:
+ *
+ *                  NORMAL      full behavior
+ *                  LOW         below low_mV: LED on-times halved, light sleep
+ *                              after idleSleep_ms without a press
+ *                  CRITICAL    below critical_mV: deep sleep at once, with the
+ *                              application's usual wake sources (Lab3: BUTTON1,
+ *                              plus the touch pads with TOUCH_INPUT)
+ *
+ *              A level is left upward only hysteresis_mV above its threshold.
+ * Target: Espressif ESP32 dev board (governor also builds on the host)
+ */
+
+#ifndef BATTERY_GOVERNOR_H_
+#define BATTERY_GOVERNOR_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Configuration */
+#define BATTERY_PERIOD          (1000)                                                          // ms between readings
+#define BATTERY_FRAME_SAMPLES   (256)                                                           // ADC samples averaged into one reading
+#define BATTERY_SAMPLE_HZ       (20000)                                                         // Slowest DMA rate on the ESP32
+#define BATTERY_DIVIDER         (2)                                                             // Supply -> 100k / 100k -> GPIO 34
+
+/* Enumerations and Structures */
+typedef enum {
+    BATTERY_NORMAL ,
+    BATTERY_LOW ,
+    BATTERY_CRITICAL
+} Battery_Level_t ;
+
+typedef enum {
+    BATTERY_ACTION_NONE ,
+    BATTERY_ACTION_SHORT_ON ,                                                                   // Shorter LED on-times
+    BATTERY_ACTION_LIGHT_SLEEP ,                                                                // Forced light sleep while idle
+    BATTERY_ACTION_DEEP_SLEEP                                                                   // Early deep sleep
+} Battery_Action_t ;
+
+typedef struct {
+    uint16_t    low_mV ;
+    uint16_t    critical_mV ;
+    uint16_t    hysteresis_mV ;
+    uint8_t     filterShift ;
+    uint32_t    idleSleep_ms ;
+    uint16_t    validMin_mV ;                                                                   // Plausible range for a single LiPo cell
+    uint16_t    validMax_mV ;
+} Battery_Config_t ;
+
+#define BATTERY_CONFIG_DEFAULT  { 3500, 3300, 100, 2, 30000, 3000, 4500 }
+
+typedef struct {
+    uint32_t            filtered_q4 ;                                                           // Smoothed supply in 1/16 mV
+    uint16_t            mV ;                                                                    // Smoothed supply, 0 until the first reading
+    Battery_Level_t     level ;
+    Battery_Action_t    action ;                                                                // Latest decision
+    uint32_t            transitions ;                                                           // Level changes so far
+    uint32_t            rejected ;                                                              // Readings outside the valid range
+} Battery_Governor_t ;
+
+/* Function Prototypes */
+Battery_Level_t     battery_governor_update(Battery_Governor_t *governor, Battery_Config_t const *config, uint16_t reading_mV) ;
+Battery_Action_t    battery_governor_decide(Battery_Governor_t *governor, Battery_Config_t const *config, uint32_t idle_ms) ;
+uint32_t            battery_on_time(Battery_Level_t level, uint32_t on_ms) ;
+
+#ifdef ARDUINO
+extern Battery_Governor_t       battery ;
+extern Battery_Config_t const   battery_config ;
+
+void                battery_init(void) ;
+bool                battery_service(uint32_t currentMillis) ;                                   // True when a new valid reading went in
+#endif
+
+#endif /* BATTERY_GOVERNOR_H_ */
@@ -0,0 +1,100 @@
+/*
+ * Name: BootTiming
+ * Description: See BootTiming.h. The deep sleep wake stub runs from RTC fast
+ *              memory before the bootloader, so it can only touch registers
+ *              and RTC memory: it latches the raw RTC counter. The app marks
+ *              latch the same raw counter, and every phase is converted with
+ *              one calibrated slow clock period, so no phase mixes the
+ *              calibration the IDF has folded into esp_clk_rtc_time() with
+ *              the current one.
+ */
+
+#include "BootTiming.h"
+#include <esp_sleep.h>
+#include <esp32/clk.h>
+#include <esp32/rom/rtc.h>
+#include <soc/rtc.h>
+#include <soc/rtc_cntl_reg.h>
+
+/* State Variables */
+BootTiming_t                    boot_timing ;
+
+RTC_DATA_ATTR static uint64_t   stubTicks ;                                                     // RTC counter when the wake stub ran
+static uint64_t                 appStartTicks ;                                                 // Raw RTC counter at each mark; all of them
+static uint64_t                 setupStartTicks ;                                               // are converted together in
+static uint64_t                 firstOutputTicks ;                                              // boot_mark_setup_done().
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/* Function Definitions */
+
+void RTC_IRAM_ATTR esp_wake_deep_sleep(void) {                                                  // Replaces the IDF's weak wake stub
+    esp_default_wake_deep_sleep() ;
+    SET_PERI_REG_MASK(RTC_CNTL_TIME_UPDATE_REG, RTC_CNTL_TIME_UPDATE) ;
+    while (GET_PERI_REG_MASK(RTC_CNTL_TIME_UPDATE_REG, RTC_CNTL_TIME_VALID) == 0) {
+    }
+    stubTicks = READ_PERI_REG(RTC_CNTL_TIME0_REG) | ((uint64_t)READ_PERI_REG(RTC_CNTL_TIME1_REG) << 32) ;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void __attribute__((constructor(101))) boot_mark_app_start(void) {                      // First constructor to run, as close to the
+    appStartTicks = rtc_time_get() ;                                                            // bootloader handing over as C++ gets.
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void boot_mark_setup(void) {                                                                    // First line of setup()
+    setupStartTicks = rtc_time_get() ;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void boot_mark_first_output(void) {                                                             // Right after the first LED write
+    firstOutputTicks = rtc_time_get() ;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static uint32_t ticks_to_us(uint64_t ticks, uint32_t cal) {                                     // Differences only, so the same calibration
+    return (uint32_t)rtc_time_slowclk_to_us(ticks, cal) ;                                       // applies to both ends of every phase.
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void boot_mark_setup_done(void) {                                                               // Last line of setup(); works out the phases
+    uint64_t const  setupDoneTicks  = rtc_time_get() ;
+    uint32_t const  cal             = esp_clk_slowclk_cal_get() ;                               // One slow clock period for every mark
+    uint64_t        preAppTicks     = appStartTicks ;                                           // Any other reset: count from the constructor
+
+    boot_timing.resetReason     = rtc_get_reset_reason(0) ;
+    boot_timing.fromDeepSleep   = (boot_timing.resetReason == DEEPSLEEP_RESET) ;
+    boot_timing.preApp_us       = BOOT_TIME_UNKNOWN ;
+    if (boot_timing.resetReason == POWERON_RESET) {                                             // Counter started from 0 with this reset
+        preAppTicks = 0 ;
+        boot_timing.preApp_us = ticks_to_us(appStartTicks, cal) ;
+    }
+    else if (boot_timing.fromDeepSleep) {
+        preAppTicks = stubTicks ;
+        boot_timing.preApp_us = ticks_to_us(appStartTicks - stubTicks, cal) ;
+    }
+    boot_timing.appInit_us          = ticks_to_us(setupStartTicks - appStartTicks, cal) ;
+    boot_timing.toFirstOutput_us    = ticks_to_us(firstOutputTicks - setupStartTicks, cal) ;
+    boot_timing.setupRest_us        = ticks_to_us(setupDoneTicks - firstOutputTicks, cal) ;
+    boot_timing.total_us            = ticks_to_us(setupDoneTicks - preAppTicks, cal) ;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void boot_report(Print &out) {                                                                  // One line per phase
+    if (boot_timing.fromDeepSleep) {
+        out.printf("Boot (deep sleep wake):\n") ;
+        out.printf("  %-22s %8u us\n", "wake stub -> app",  boot_timing.preApp_us) ;
+    }
+    else if (boot_timing.preApp_us != BOOT_TIME_UNKNOWN) {
+        out.printf("Boot (power-on):\n") ;
+        out.printf("  %-22s %8u us\n", "ROM + bootloader",  boot_timing.preApp_us) ;
+    }
+    else {
+        out.printf("Boot (reset reason %u):\n", boot_timing.resetReason) ;
+        out.printf("  %-22s %8s\n", "ROM + bootloader",    "unknown") ;
+    }
+    out.printf("  %-22s %8u us\n", "app init",              boot_timing.appInit_us) ;
+    out.printf("  %-22s %8u us\n", "setup -> first LED",    boot_timing.toFirstOutput_us) ;
+    out.printf("  %-22s %8u us\n", "rest of setup",         boot_timing.setupRest_us) ;
+    out.printf("  %-22s %8u us\n", (boot_timing.preApp_us == BOOT_TIME_UNKNOWN) ? "total from app" : "total",
+               boot_timing.total_us) ;
+}
@@ -0,0 +1,55 @@
+/*
+ * Name: BootTiming
+ * Description: Reset-to-first-LED timing breakdown. Every phase is read from
+ *              the RTC counter, which keeps running from reset (and across
+ *              deep sleep), so the time spent before the application starts
+ *              is visible to it:
+ *
+ *                  pre-app     power-on:   reset -> first C++ constructor (ROM + bootloader + image load)
+ *                              deep sleep: wake stub -> first C++ constructor (bootloader + image load;
+ *                                          the wake instant itself is not latched by the hardware)
+ *                              otherwise:  BOOT_TIME_UNKNOWN
+ *                  app init    constructor -> setup()                          FreeRTOS, Arduino core
+ *                  setup       setup() -> first LED write
+ *                  remainder   first LED write -> end of setup()
+ *
+ *              Only a power-on reset clears the RTC counter, so only then is
+ *              the constructor's timestamp also the time since reset. Software,
+ *              watchdog and brownout resets leave it running, and pre-app is
+ *              reported as unknown rather than as the whole previous run.
+ *
+ *              ROM and bootloader cannot be split: the ROM hands over to the
+ *              second stage bootloader without latching a timestamp, and the
+ *              bootloader is the prebuilt one shipped with the Arduino core,
+ *              so nothing can be added to it to record its own start.
+ * Target: Espressif ESP32 dev board
+ */
+
+#ifndef BOOT_TIMING_H_
+#define BOOT_TIMING_H_
+
+#include <Arduino.h>
+
+/* Constants */
+#define BOOT_TIME_UNKNOWN   (0xFFFFFFFFUL)                                                      // preApp_us when the reset kept the RTC counter
+
+/* Enumerations and Structures */
+typedef struct {
+    bool        fromDeepSleep ;
+    uint8_t     resetReason ;                                                                   // RESET_REASON from the ROM, CPU 0
+    uint32_t    preApp_us ;
+    uint32_t    appInit_us ;
+    uint32_t    toFirstOutput_us ;                                                              // setup() entry to first LED write
+    uint32_t    setupRest_us ;
+    uint32_t    total_us ;                                                                      // Sum of the known phases above
+} BootTiming_t ;
+
+extern BootTiming_t boot_timing ;
+
+/* Function Prototypes */
+void    boot_mark_setup(void) ;
+void    boot_mark_first_output(void) ;
+void    boot_mark_setup_done(void) ;
+void    boot_report(Print &out) ;
+
+#endif /* BOOT_TIMING_H_ */
@@ -0,0 +1,203 @@
+/*
+ * Name: KeyMatrix
+ * Description: See KeyMatrix.h. The debounce and the event queue (a
+ *              StaticRing) need no Arduino core, so the host tools can build
+ *              them; scanning only exists on the ESP32. Rows are open-drain so
+ *              two keys held in one column can never short a driven HIGH row
+ *              to a driven LOW one.
+ */
+
+#include "KeyMatrix.h"
+#include <StaticRing.h>
+#include <string.h>
+
+#ifdef ARDUINO
+    #include <Arduino.h>
+    #include <hal/cpu_hal.h>
+    #include <hal/gpio_ll.h>
+    #include <rom/ets_sys.h>
+#endif
+
+/* State Variables */
+KeyMatrix_Stats_t   keymatrix_stats ;
+
+static uint32_t     keyState[KEY_WORDS] ;                                                       // Debounced: bit set = key down
+static uint32_t     keyCount0[KEY_WORDS] ;                                                      // Vertical counter, low bit plane
+static uint32_t     keyCount1[KEY_WORDS] ;                                                      // Vertical counter, high bit plane
+static uint8_t      quietPasses = KEY_DEBOUNCE ;                                                // Passes in a row with every key up, no counter
+static StaticRing<KeyEvent_t, KEY_QUEUE_LEN>    eventQueue ;                                    // Pushed by the scan, popped by the application
+
+#ifdef ARDUINO
+static uint8_t      rowPin[KEY_MAX] ;                                                           // DRAM copies: the ISR must not read flash
+static uint8_t      colPin[KEY_MAX] ;
+static uint8_t      rowCount ;
+static uint8_t      colCount ;
+static uint32_t     rowMask0, rowMask1 ;                                                        // GPIO 0-31 and 32-39 banks
+static uint32_t     colMask0, colMask1 ;
+static bool volatile scanActive ;
+static bool         scanWoken ;                                                                 // Wakeup already counted for this active spell
+static uint32_t     previousMillis_Scan ;
+#endif
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/* Function Definitions */
+
+static void event_push(uint16_t key, bool down) {
+    KeyEvent_t const event = { key, down } ;
+    if (!eventQueue.push(event)) {
+        keymatrix_stats.dropped++ ;
+    }
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool keymatrix_get_event(KeyEvent_t *event) {                                                   // Oldest event first; false when empty
+    return eventQueue.pop(event) ;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void keymatrix_debounce(uint32_t const *raw) {                                                  // 32 keys per word at once. Per key, a 2-bit
+    for (uint32_t w = 0 ; w < KEY_WORDS ; w++) {                                                // counter runs while the raw sample disagrees
+        uint32_t const delta = raw[w] ^ keyState[w] ;                                           // with the debounced state and is cleared as
+        keyCount1[w]    = (keyCount1[w] ^ keyCount0[w]) & delta ;                               // soon as they agree. It wraps to 0 on the
+        keyCount0[w]    = ~keyCount0[w] & delta ;                                               // 4th disagreeing sample, which is the toggle.
+        uint32_t toggle = delta & ~(keyCount0[w] | keyCount1[w]) ;
+        keyState[w]    ^= toggle ;
+
+        while (toggle) {                                                                        // One event per key that changed
+            uint32_t const bit = __builtin_ctz(toggle) ;
+            event_push(w * 32 + bit, (keyState[w] >> bit) & 1) ;
+            toggle &= toggle - 1 ;
+        }
+    }
+
+    bool quiet = true ;                                                                         // A bounce that opens for one sample clears
+    for (uint32_t w = 0 ; w < KEY_WORDS ; w++) {                                                // its counter, so one quiet pass proves
+        if (keyState[w] | keyCount0[w] | keyCount1[w]) {                                        // nothing; count them.
+            quiet = false ;
+        }
+    }
+    if (!quiet) {
+        quietPasses = 0 ;
+    }
+    else if (quietPasses < KEY_DEBOUNCE) {
+        quietPasses++ ;
+    }
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool keymatrix_is_down(uint16_t key) {                                                          // Debounced state of one key
+    return (key < KEY_MAX) && ((keyState[key / 32] >> (key % 32)) & 1) ;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool keymatrix_settled(void) {                                                                  // Every key up and no counter running for
+    return quietPasses >= KEY_DEBOUNCE ;                                                        // KEY_DEBOUNCE passes in a row
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifdef ARDUINO
+static void IRAM_ATTR keymatrix_isr(void) {                                                     // Any column fell: mask them all and hand over
+    for (uint8_t c = 0 ; c < colCount ; c++) {                                                  // to the scanner in loop()
+        gpio_ll_intr_disable(&GPIO, (gpio_num_t)colPin[c]) ;
+    }
+    scanActive = true ;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void keymatrix_idle(void) {                                                              // All rows LOW, so any key pulls its column LOW;
+    GPIO.out_w1tc           = rowMask0 ;                                                        // drop edges latched during the scan and unmask.
+    GPIO.out1_w1tc.data     = rowMask1 ;                                                        // A key that closed before the unmask left no
+    ets_delay_us(KEY_ROW_SETTLE_US) ;                                                           // edge behind, so read the columns afterwards
+    gpio_ll_clear_intr_status(&GPIO, colMask0) ;                                                // and keep scanning if any of them is LOW.
+    gpio_ll_clear_intr_status_high(&GPIO, colMask1) ;
+    scanActive = false ;
+    for (uint8_t c = 0 ; c < colCount ; c++) {
+        gpio_intr_enable((gpio_num_t)colPin[c]) ;
+    }
+    if ( ((GPIO.in & colMask0) == colMask0) && ((GPIO.in1.data & colMask1) == colMask1) ) {
+        scanWoken = false ;
+        return ;
+    }
+    for (uint8_t c = 0 ; c < colCount ; c++) {
+        gpio_ll_intr_disable(&GPIO, (gpio_num_t)colPin[c]) ;
+    }
+    scanActive = true ;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void keymatrix_scan(void) {                                                              // One pass: pull each row LOW in turn and read
+    uint32_t        raw[KEY_WORDS] = {} ;                                                       // every column with a single register read.
+    uint32_t const  start = cpu_hal_get_cycle_count() ;
+
+    GPIO.out_w1ts           = rowMask0 ;                                                        // Release every row
+    GPIO.out1_w1ts.data     = rowMask1 ;
+    for (uint8_t r = 0 ; r < rowCount ; r++) {
+        if (rowPin[r] < 32) GPIO.out_w1tc           = 1UL << rowPin[r] ;
+        else                GPIO.out1_w1tc.data     = 1UL << (rowPin[r] - 32) ;
+        ets_delay_us(KEY_ROW_SETTLE_US) ;
+        uint32_t const in0 = ~GPIO.in ;                                                         // Active LOW: bit set = pressed
+        uint32_t const in1 = ~GPIO.in1.data ;
+        if (rowPin[r] < 32) GPIO.out_w1ts           = 1UL << rowPin[r] ;
+        else                GPIO.out1_w1ts.data     = 1UL << (rowPin[r] - 32) ;
+
+        for (uint8_t c = 0 ; c < colCount ; c++) {
+            uint32_t const down = (colPin[c] < 32) ? (in0 >> colPin[c]) : (in1 >> (colPin[c] - 32)) ;
+            uint32_t const key  = r * colCount + c ;
+            raw[key / 32] |= (down & 1) << (key % 32) ;
+        }
+    }
+    keymatrix_debounce(raw) ;
+
+    uint32_t const cycles = cpu_hal_get_cycle_count() - start ;
+    keymatrix_stats.passes++ ;
+    keymatrix_stats.lastCycles      = cycles ;
+    keymatrix_stats.totalCycles    += cycles ;
+    if (cycles > keymatrix_stats.maxCycles) {
+        keymatrix_stats.maxCycles   = cycles ;
+    }
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void keymatrix_init(uint8_t const *rowPins, uint8_t rows, uint8_t const *colPins, uint8_t cols) {
+    if ((uint32_t)rows * cols > KEY_MAX) {                                                      // Drop rows that would not fit in the bitsets
+        log_e("%u x %u keys exceeds KEY_MAX (%u)", rows, cols, KEY_MAX) ;
+        rows = KEY_MAX / cols ;
+    }
+    rowCount = rows ;
+    colCount = cols ;
+    memcpy(rowPin, rowPins, rows) ;
+    memcpy(colPin, colPins, cols) ;
+
+    for (uint8_t r = 0 ; r < rows ; r++) {
+        pinMode(rowPin[r], OUTPUT_OPEN_DRAIN) ;
+        if (rowPin[r] < 32) rowMask0 |= 1UL << rowPin[r] ;
+        else                rowMask1 |= 1UL << (rowPin[r] - 32) ;
+    }
+    for (uint8_t c = 0 ; c < cols ; c++) {                                                      // GPIO 34-39 have no pull-ups; use external ones
+        pinMode(colPin[c], INPUT_PULLUP) ;
+        if (colPin[c] < 32) colMask0 |= 1UL << colPin[c] ;
+        else                colMask1 |= 1UL << (colPin[c] - 32) ;
+        attachInterrupt(digitalPinToInterrupt(colPin[c]), keymatrix_isr, FALLING) ;
+    }
+    keymatrix_idle() ;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void keymatrix_service(uint32_t currentMillis) {                                                // Call every loop(); scans only while active
+    if (!scanActive) {
+        return ;
+    }
+    if ( (currentMillis - previousMillis_Scan) < KEY_SCAN_PERIOD ) {
+        return ;
+    }
+    if (!scanWoken) {                                                                           // First pass since the interrupt
+        scanWoken = true ;
+        keymatrix_stats.wakeups++ ;
+    }
+    previousMillis_Scan = currentMillis ;
+    keymatrix_scan() ;
+    if (keymatrix_settled()) {                                                                  // Bounce died out with every key up
+        keymatrix_idle() ;
+    }
+}
+#endif
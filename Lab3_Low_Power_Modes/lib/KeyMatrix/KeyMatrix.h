@@ -0,0 +1,64 @@
+/*
+ * Name: KeyMatrix
+ * Description: Scanned N x M key matrix, the many-key version of BUTTON1.
+ *              Rows are outputs, columns are inputs with pull-ups, keys are
+ *              active LOW like the on-board button.
+ *
+ *              Idle:   every row is driven LOW and every column has a FALLING
+ *                      edge interrupt, so any key press fires one interrupt
+ *                      and the CPU does nothing until then.
+ *              Active: the interrupts are masked and keymatrix_service() scans
+ *                      one pass every KEY_SCAN_PERIOD ms with direct GPIO
+ *                      register writes and reads, until every key has been
+ *                      released and settled, then it goes back to idle.
+ *
+ *              Debouncing is done for all keys at once with 2-bit vertical
+ *              counters held in bitsets (one bit per key per plane), so a
+ *              key must read the same for 4 passes in a row to change state.
+ *              State changes are pushed to a key up / key down event queue.
+ * Target: Espressif ESP32 dev board (debounce and queue also build on the host)
+ */
+
+#ifndef KEY_MATRIX_H_
+#define KEY_MATRIX_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Configuration */
+#ifndef KEY_MAX
+    #define KEY_MAX             (128)                                                           // Rows x columns must fit
+#endif
+#define KEY_WORDS               ((KEY_MAX + 31) / 32)
+#define KEY_QUEUE_LEN           (32)                                                            // Power of two, holds 31 events
+#define KEY_SCAN_PERIOD         (2)                                                             // ms per pass, 4 passes to debounce
+#define KEY_ROW_SETTLE_US       (2)                                                             // Let the column lines settle after a row change
+#define KEY_DEBOUNCE            (4)                                                             // Quiet passes in a row before going idle
+
+/* Enumerations and Structures */
+typedef struct {
+    uint16_t    key ;                                                                           // row * columns + column
+    bool        down ;
+} KeyEvent_t ;
+
+typedef struct {
+    uint32_t    passes ;
+    uint32_t    lastCycles ;                                                                    // CPU cycles spent in the latest pass
+    uint32_t    maxCycles ;
+    uint64_t    totalCycles ;
+    uint32_t    wakeups ;                                                                       // Idle -> active transitions
+    uint32_t    dropped ;                                                                       // Events lost to a full queue
+} KeyMatrix_Stats_t ;
+
+extern KeyMatrix_Stats_t keymatrix_stats ;
+
+/* Function Prototypes */
+void        keymatrix_init(uint8_t const *rowPins, uint8_t rows, uint8_t const *colPins, uint8_t cols) ;
+void        keymatrix_service(uint32_t currentMillis) ;
+bool        keymatrix_get_event(KeyEvent_t *event) ;
+bool        keymatrix_is_down(uint16_t key) ;
+
+void        keymatrix_debounce(uint32_t const *raw) ;                                           // One pass worth of raw samples (bit set = pressed)
+bool        keymatrix_settled(void) ;
+
+#endif /* KEY_MATRIX_H_ */
@@ -0,0 +1,119 @@
+/*
+ * Name: LoopProfiler
+ * Description: See LoopProfiler.h. The dump runs from the task watchdog
+ *              interrupt, so its code, counters and format strings stay in
+ *              IRAM/DRAM and it prints with the ROM's ets_printf(). The
+ *              PROFILE_SCOPE() tags are string literals in flash: they are
+ *              read through the cache, and printed as addresses instead if
+ *              the stall caught the cache disabled for a flash write.
+ */
+
+#include "LoopProfiler.h"
+#include <esp_task_wdt.h>
+#include <esp_timer.h>
+#include <esp_spi_flash.h>
+
+/* State Variables */
+Profile_t                       profile ;
+char const * volatile           profiler_activeTag ;
+
+static int64_t                  loopStart_us ;                                                  // esp_timer at profiler_loop_begin()
+static char const              *loopTag ;                                                       // Slowest scope so far in this iteration
+static uint32_t                 loopTag_us ;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/* Function Definitions */
+
+void profiler_init(uint32_t budget_us, uint32_t watchdog_s) {                                   // Puts the loop task on the task watchdog with a
+    profile.budget_us   = budget_us ;                                                           // timeout of watchdog_s. On IDF 4.4 init also
+    esp_task_wdt_init(watchdog_s, true) ;                                                       // reconfigures the one the startup code started.
+    esp_task_wdt_add(NULL) ;
+    profiler_loop_begin() ;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+uint32_t IRAM_ATTR profiler_micros(void) {                                                      // esp_timer, which light sleep compensates for;
+    return (uint32_t)esp_timer_get_time() ;                                                     // differences are good for ~71 minutes.
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void profiler_loop_begin(void) {
+    loopTag             = "loop" ;
+    loopTag_us          = 0 ;
+    profiler_activeTag  = "loop" ;
+    loopStart_us        = esp_timer_get_time() ;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void profiler_scope_end(char const *tag, uint32_t start_us, uint32_t budget_us) {               // Keeps the slowest scope of this iteration and
+    uint32_t const elapsed = profiler_micros() - start_us ;                                     // counts a budgeted scope that overran.
+
+    if (budget_us && (elapsed > budget_us)) {
+        profile.overBudget++ ;
+    }
+    if (elapsed > loopTag_us) {
+        loopTag_us      = elapsed ;
+        loopTag         = tag ;
+    }
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void profiler_loop_end(void) {                                                                  // Histogram, budget check and top-N insert, then
+    uint32_t const  loop_us = (uint32_t)(esp_timer_get_time() - loopStart_us) ;                 // feeds the watchdog.
+    int             bucket  = loop_us ? 31 - __builtin_clz(loop_us) : 0 ;
+    int             i ;
+
+    profile.histogram[bucket]++ ;
+    profile.iterations++ ;
+    if (loop_us > profile.budget_us) {
+        profile.overBudget++ ;
+    }
+
+    if (loop_us > profile.worst[PROFILER_TOP - 1].loop_us) {                                    // Insertion into the sorted worst list
+        for (i = PROFILER_TOP - 1 ; (i > 0) && (profile.worst[i - 1].loop_us < loop_us) ; i--) {
+            profile.worst[i] = profile.worst[i - 1] ;
+        }
+        profile.worst[i].tag        = loopTag ;
+        profile.worst[i].loop_us    = loop_us ;
+        profile.worst[i].scope_us   = loopTag_us ;
+        profile.worst[i].at_ms      = millis() ;
+    }
+
+    esp_task_wdt_reset() ;
+    profiler_loop_begin() ;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void IRAM_ATTR print_tag(char const *tag) {                                              // The tag itself, or its address when flash is
+    if (spi_flash_cache_enabled()) {                                                            // unreadable; look that up in the linker map.
+        ets_printf(DRAM_STR("%s"), tag) ;
+    }
+    else {
+        ets_printf(DRAM_STR("%p"), tag) ;
+    }
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void IRAM_ATTR profiler_dump(void) {                                                            // Prints the histogram and the worst stalls
+    ets_printf(DRAM_STR("loop(): %u iterations, %u over budget (loop budget %u us)\n"),
+               profile.iterations, profile.overBudget, profile.budget_us) ;
+    for (int i = 0 ; i < PROFILER_BUCKETS ; i++) {
+        if (profile.histogram[i]) {
+            ets_printf(DRAM_STR("  %10u - %10u us : %u\n"), 1UL << i, (2UL << i) - 1, profile.histogram[i]) ;
+        }
+    }
+    for (int i = 0 ; (i < PROFILER_TOP) && profile.worst[i].loop_us ; i++) {
+        ets_printf(DRAM_STR("  #%d  %10u us in loop(), %10u us in "), i + 1,
+                   profile.worst[i].loop_us, profile.worst[i].scope_us) ;
+        print_tag(profile.worst[i].tag) ;
+        ets_printf(DRAM_STR(" at %u ms\n"), profile.worst[i].at_ms) ;
+    }
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+extern "C" void IRAM_ATTR esp_task_wdt_isr_user_handler(void) {                                 // Weak hook in the IDF task watchdog ISR, runs
+    ets_printf(DRAM_STR("\nloop() stalled in \"")) ;                                            // just before the panic handler resets us. It
+    print_tag(profiler_activeTag) ;                                                             // may run on either core; esp_timer is the same
+    ets_printf(DRAM_STR("\" for %u us\n"), (uint32_t)(esp_timer_get_time() - loopStart_us)) ;  // on both.
+    profiler_dump() ;
+}
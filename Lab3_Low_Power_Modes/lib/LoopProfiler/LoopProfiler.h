@@ -0,0 +1,83 @@
+/*
+ * Name: LoopProfiler
+ * Description: Finds main loop stalls. Each loop() iteration is timed on
+ *              esp_timer, which keeps counting through light sleep (the CPU
+ *              cycle counter stops), and lands in a log2 histogram; the
+ *              PROFILER_TOP slowest iterations are kept together with the tag
+ *              of the slowest PROFILE_SCOPE() inside them. A scope opened
+ *              with PROFILE_SCOPE_BUDGET() counts as a stall on its own when
+ *              it runs past its budget, so a loop built from long phases
+ *              needs no loop-wide slack. The loop task is added to the task
+ *              watchdog, and if it ever stalls past the watchdog timeout the
+ *              histogram and worst stalls are printed from the watchdog
+ *              interrupt before the reset.
+ *
+ * Usage:       profiler_init(50000, 15) ;              in setup()
+ *              profiler_loop_begin() ;                 first line of loop()
+ *              PROFILE_SCOPE("change_to_state3") ;     inside any suspect block
+ *              PROFILE_SCOPE_BUDGET("blink", 6020000) ; same, with its own budget
+ *              profiler_loop_end() ;                   last line of loop()
+ * Target: Espressif ESP32 dev board
+ */
+
+#ifndef LOOP_PROFILER_H_
+#define LOOP_PROFILER_H_
+
+#include <Arduino.h>
+
+/* Configuration */
+#define PROFILER_TOP            (8)                                                             // Worst stalls remembered
+#define PROFILER_BUCKETS        (32)                                                            // Bucket n holds [2^n, 2^(n+1)) us
+
+/* Enumerations and Structures */
+typedef struct {
+    char const *tag ;                                                                           // Slowest scope inside the iteration (or "loop")
+    uint32_t    loop_us ;                                                                       // Whole iteration
+    uint32_t    scope_us ;                                                                      // The tagged scope alone
+    uint32_t    at_ms ;                                                                         // millis() when it ended
+} Stall_t ;
+
+typedef struct {
+    uint32_t    histogram[PROFILER_BUCKETS] ;
+    Stall_t     worst[PROFILER_TOP] ;                                                           // Sorted, slowest first
+    uint32_t    iterations ;
+    uint32_t    overBudget ;                                                                    // Iterations and budgeted scopes that overran
+    uint32_t    budget_us ;
+} Profile_t ;
+
+extern Profile_t                profile ;
+extern char const * volatile    profiler_activeTag ;                                            // Innermost open scope, read by the watchdog hook
+
+/* Function Prototypes */
+void        profiler_init(uint32_t budget_us, uint32_t watchdog_s) ;
+void        profiler_loop_begin(void) ;
+void        profiler_loop_end(void) ;
+void        profiler_scope_end(char const *tag, uint32_t start_us, uint32_t budget_us) ;
+uint32_t    profiler_micros(void) ;
+void        profiler_dump(void) ;
+
+/* Scoped timer: records the enclosing block under tag */
+class ProfileScope {
+    public:
+        explicit ProfileScope(char const *tag, uint32_t budget_us = 0) :                        // budget_us 0: no budget of its own
+            tag(tag), parent(profiler_activeTag), budget_us(budget_us), start_us(profiler_micros()) {
+            profiler_activeTag = tag ;
+        }
+        ~ProfileScope() {
+            profiler_scope_end(tag, start_us, budget_us) ;
+            profiler_activeTag = parent ;
+        }
+    private:
+        char const     *tag ;
+        char const     *parent ;
+        uint32_t        budget_us ;
+        uint32_t        start_us ;
+} ;
+
+#define PROFILE_CONCAT_(a, b)   a##b
+#define PROFILE_CONCAT(a, b)    PROFILE_CONCAT_(a, b)
+#define PROFILE_SCOPE(tag)      ProfileScope PROFILE_CONCAT(profileScope_, __LINE__)(tag)
+#define PROFILE_SCOPE_BUDGET(tag, budget_us)                                                    \
+                                ProfileScope PROFILE_CONCAT(profileScope_, __LINE__)(tag, budget_us)
+
+#endif /* LOOP_PROFILER_H_ */
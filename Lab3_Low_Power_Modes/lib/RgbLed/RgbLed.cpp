@@ -0,0 +1,150 @@
+/*
+ * Name: RgbLed
+ * Description: See RgbLed.h.
+ */
+
+#include "RgbLed.h"
+#include <driver/ledc.h>
+
+/* Constants */
+static ledc_mode_t const    RGB_MODE        = LEDC_HIGH_SPEED_MODE ;                           // The only mode with hardware fades on the ESP32
+static ledc_timer_t const   RGB_TIMER       = LEDC_TIMER_0 ;
+static ledc_channel_t const RGB_CHANNEL[3]  = { LEDC_CHANNEL_0, LEDC_CHANNEL_1, LEDC_CHANNEL_2 } ;
+
+static uint16_t const RGB_GAMMA[256] = {                                                        // round(8191 * (i / 255)^2.8), gamma 2.8
+       0,    0,    0,    0,    0,    0,    0,    0,    1,    1,    1,    1,    2,    2,    2,    3,
+       4,    4,    5,    6,    7,    8,    9,   10,   11,   12,   14,   15,   17,   19,   20,   22,
+      25,   27,   29,   32,   34,   37,   40,   43,   46,   49,   52,   56,   60,   64,   68,   72,
+      76,   81,   86,   90,   95,  101,  106,  112,  117,  123,  130,  136,  143,  149,  156,  163,
+     171,  178,  186,  194,  202,  211,  219,  228,  237,  247,  256,  266,  276,  287,  297,  308,
+     319,  330,  342,  354,  366,  378,  390,  403,  416,  430,  444,  457,  472,  486,  501,  516,
+     531,  547,  563,  579,  596,  613,  630,  647,  665,  683,  701,  720,  739,  758,  778,  798,
+     818,  839,  860,  881,  903,  925,  947,  970,  993, 1016, 1040, 1064, 1088, 1113, 1138, 1163,
+    1189, 1215, 1242, 1269, 1296, 1324, 1352, 1380, 1409, 1438, 1468, 1498, 1528, 1559, 1590, 1622,
+    1654, 1686, 1719, 1752, 1785, 1819, 1854, 1889, 1924, 1960, 1996, 2032, 2069, 2106, 2144, 2182,
+    2221, 2260, 2300, 2340, 2380, 2421, 2462, 2504, 2546, 2589, 2632, 2676, 2720, 2764, 2809, 2855,
+    2900, 2947, 2994, 3041, 3089, 3137, 3186, 3235, 3285, 3335, 3386, 3437, 3489, 3541, 3594, 3647,
+    3701, 3755, 3810, 3865, 3920, 3977, 4034, 4091, 4149, 4207, 4266, 4325, 4385, 4446, 4507, 4568,
+    4630, 4693, 4756, 4820, 4884, 4949, 5014, 5080, 5146, 5213, 5281, 5349, 5418, 5487, 5557, 5627,
+    5698, 5769, 5842, 5914, 5987, 6061, 6136, 6211, 6286, 6362, 6439, 6517, 6594, 6673, 6752, 6832,
+    6912, 6993, 7075, 7157, 7240, 7323, 7407, 7492, 7577, 7663, 7749, 7836, 7924, 8012, 8101, 8191
+} ;
+
+/* State Variables */
+static Rgb_t                requested ;                                                         // Latest request from the application
+static uint32_t             requested_ms ;
+static Rgb_t                started ;                                                           // What the hardware was last told to show
+static bool                 pending ;
+static uint8_t volatile     fadesRunning ;                                                      // Channels still fading
+static TaskHandle_t         fadeOwner ;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/* Function Definitions */
+
+static bool IRAM_ATTR rgb_fade_end(ledc_cb_param_t const *param, void *arg) {                   // LEDC fade-end interrupt, once per channel. The
+    BaseType_t woken = pdFALSE ;                                                                // last channel to finish notifies the owner task.
+
+    if ( (param->event == LEDC_FADE_END_EVT) && fadesRunning && (--fadesRunning == 0) && fadeOwner ) {
+        xTaskNotifyFromISR(fadeOwner, RGB_FADE_DONE_BIT, eSetBits, &woken) ;
+    }
+    return woken == pdTRUE ;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void rgb_init(uint8_t pinR, uint8_t pinG, uint8_t pinB, bool activeLow) {                       // Routes the three pins to LEDC channels 0-2.
+    uint8_t const           pins[3] = { pinR, pinG, pinB } ;                                    // activeLow inverts the output in hardware, so a
+    ledc_cbs_t              callbacks = { .fade_cb = rgb_fade_end } ;                           // duty of 0 is always "off".
+    ledc_timer_config_t     timer = {} ;
+
+    timer.speed_mode        = RGB_MODE ;
+    timer.duty_resolution   = (ledc_timer_bit_t)RGB_LEDC_BITS ;
+    timer.timer_num         = RGB_TIMER ;
+    timer.freq_hz           = RGB_LEDC_FREQ ;
+    timer.clk_cfg           = LEDC_AUTO_CLK ;
+    ledc_timer_config(&timer) ;
+    ledc_fade_func_install(0) ;
+
+    for (int i = 0 ; i < 3 ; i++) {
+        ledc_channel_config_t channel = {} ;
+        channel.gpio_num            = pins[i] ;
+        channel.speed_mode          = RGB_MODE ;
+        channel.channel             = RGB_CHANNEL[i] ;
+        channel.timer_sel           = RGB_TIMER ;
+        channel.duty                = 0 ;
+        channel.flags.output_invert = activeLow ;
+        ledc_channel_config(&channel) ;
+        ledc_cb_register(RGB_MODE, RGB_CHANNEL[i], &callbacks, NULL) ;
+    }
+    started     = {} ;
+    requested   = {} ;
+    pending     = false ;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void rgb_fade_to(Rgb_t color, uint32_t fade_ms) {                                               // Latches a fade request; repeated requests for
+    if ( (color.r == requested.r) && (color.g == requested.g) && (color.b == requested.b) ) {    // the same color are free, so loop() can call
+        return ;                                                                                // this every iteration.
+    }
+    requested       = color ;
+    requested_ms    = fade_ms ;
+    pending         = true ;
+    rgb_service() ;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void rgb_set(Rgb_t color) {                                                                     // Jump straight to a color (no fade)
+    rgb_fade_to(color, 0) ;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void rgb_service(void) {                                                                        // Starts the latched request once the hardware
+    uint8_t const   from[3] = { started.r, started.g, started.b } ;                             // is idle. Channels that don't change are left
+    uint8_t const   to[3]   = { requested.r, requested.g, requested.b } ;                       // alone so they never raise a fade-end event.
+
+    if ( !pending || fadesRunning ) {
+        return ;
+    }
+    pending     = false ;
+    fadeOwner   = xTaskGetCurrentTaskHandle() ;
+    xTaskNotifyStateClear(fadeOwner) ;                                                          // Drop a stale "done" from the previous fade
+    ulTaskNotifyValueClear(fadeOwner, RGB_FADE_DONE_BIT) ;                                      // before this one can raise its own.
+
+    if (requested_ms == 0) {
+        for (int i = 0 ; i < 3 ; i++) {
+            ledc_set_duty(RGB_MODE, RGB_CHANNEL[i], RGB_GAMMA[to[i]]) ;
+            ledc_update_duty(RGB_MODE, RGB_CHANNEL[i]) ;
+        }
+    }
+    else {
+        for (int i = 0 ; i < 3 ; i++) {
+            if (from[i] != to[i]) {
+                fadesRunning++ ;
+            }
+        }
+        for (int i = 0 ; i < 3 ; i++) {
+            if (from[i] != to[i]) {
+                ledc_set_fade_with_time(RGB_MODE, RGB_CHANNEL[i], RGB_GAMMA[to[i]], requested_ms) ;
+                ledc_fade_start(RGB_MODE, RGB_CHANNEL[i], LEDC_FADE_NO_WAIT) ;
+            }
+        }
+    }
+    started = requested ;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool rgb_fade_busy(void) {                                                                      // True while a fade runs or a request is latched
+    return pending || fadesRunning ;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool rgb_fade_wait(TickType_t ticks) {                                                          // Blocks the calling task (not the CPU) until
+    uint32_t bits = 0 ;                                                                         // the running fade ends. Returns false on timeout.
+
+    if (!fadesRunning) {
+        return true ;
+    }
+    if (xTaskNotifyWait(0, RGB_FADE_DONE_BIT, &bits, ticks) != pdTRUE) {
+        return false ;
+    }
+    return (bits & RGB_FADE_DONE_BIT) != 0 ;
+}
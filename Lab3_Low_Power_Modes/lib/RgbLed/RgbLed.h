@@ -0,0 +1,40 @@
+/*
+ * Name: RgbLed
+ * Description: Drives LED1 (R, G, B) from the LEDC peripheral instead of
+ *              digitalWrite(). Colors are 8-bit per channel and pass through a
+ *              gamma table so fades look linear to the eye. Fades run in the
+ *              LEDC hardware; the fade-end interrupt notifies the task that
+ *              started the fade, so nothing polls while a fade is running.
+ *
+ *              Requests are latched by rgb_fade_to() / rgb_set() and started by
+ *              rgb_service() once the previous fade has finished, because the
+ *              LEDC driver blocks if a new fade is started over a running one.
+ * Target: Espressif ESP32 dev board
+ */
+
+#ifndef RGB_LED_H_
+#define RGB_LED_H_
+
+#include <Arduino.h>
+
+/* Configuration */
+#define RGB_LEDC_BITS       (13)                                                                // Duty resolution, matches RGB_GAMMA
+#define RGB_LEDC_FREQ       (5000)                                                              // Hz, well above flicker
+#define RGB_FADE_DONE_BIT   (1UL << 0)                                                          // Task notification bit for a finished fade
+
+/* Enumerations and Structures */
+typedef struct {
+    uint8_t r ;
+    uint8_t g ;
+    uint8_t b ;
+} Rgb_t ;
+
+/* Function Prototypes */
+void        rgb_init(uint8_t pinR, uint8_t pinG, uint8_t pinB, bool activeLow) ;
+void        rgb_set(Rgb_t color) ;
+void        rgb_fade_to(Rgb_t color, uint32_t fade_ms) ;
+void        rgb_service(void) ;
+bool        rgb_fade_busy(void) ;
+bool        rgb_fade_wait(TickType_t ticks) ;
+
+#endif /* RGB_LED_H_ */
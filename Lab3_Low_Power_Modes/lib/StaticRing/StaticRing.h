@@ -0,0 +1,69 @@
+/*
+ * Name: StaticRing
+ * Description: Compile-time sized FIFO for runtime event queues, so nothing
+ *              the labs queue after setup() comes from the heap.
+ *
+ *              StaticRing<T, N>    N slots of T in .bss (N a power of two).
+ *                                  push() copies an item in and returns false
+ *                                  when full; pop() copies the oldest out and
+ *                                  returns false when empty. Lock-free for
+ *                                  one producer and one consumer (e.g. an ISR
+ *                                  and loop(), on either core): the indices
+ *                                  are atomics with acquire/release ordering.
+ *                                  More producers need a lock.
+ *
+ * Usage:       static StaticRing<KeyEvent_t, 32>   events ;
+ *              events.push(event) ;   ...   while (events.pop(&event)) { }
+ * Target: Espressif ESP32 dev board (also builds on the host)
+ */
+
+#ifndef STATIC_RING_H_
+#define STATIC_RING_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+
+template <typename T, size_t N>
+class StaticRing {
+    static_assert((N >= 2) && ((N & (N - 1)) == 0), "StaticRing size must be a power of two") ;
+
+    public:
+        bool push(T const &item) {                                                              // Producer side. The release store publishes
+            size_t const at   = head.load(std::memory_order_relaxed) ;                          // the slot only after it is written, even to a
+            size_t const next = (at + 1) & (N - 1) ;                                            // consumer on the other core.
+            if (next == tail.load(std::memory_order_acquire)) {
+                return false ;
+            }
+            slots[at] = item ;
+            head.store(next, std::memory_order_release) ;
+            if (size() > peak) {
+                peak = size() ;
+            }
+            return true ;
+        }
+
+        bool pop(T *item) {                                                                     // Consumer side, oldest first. The slot is
+            size_t const at = tail.load(std::memory_order_relaxed) ;                            // read before the release hands it back.
+            if (at == head.load(std::memory_order_acquire)) {
+                return false ;
+            }
+            *item = slots[at] ;
+            tail.store((at + 1) & (N - 1), std::memory_order_release) ;
+            return true ;
+        }
+
+        size_t size(void) const {
+            return (head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire)) & (N - 1) ;
+        }
+        size_t highWater(void) const    { return peak ; }                                       // Most items ever queued: size N from this
+        static constexpr size_t capacity = N - 1 ;                                              // One slot tells full from empty
+
+    private:
+        T                   slots[N] ;
+        std::atomic<size_t> head { 0 } ;
+        std::atomic<size_t> tail { 0 } ;
+        size_t              peak = 0 ;
+} ;
+
+#endif /* STATIC_RING_H_ */
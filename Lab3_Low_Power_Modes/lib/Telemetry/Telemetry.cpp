@@ -0,0 +1,152 @@
+/*
+ * Name: Telemetry
+ * Description: See Telemetry.h. The framing half (CRC, COBS) is plain C so the
+ *              host tools can build it; the UART half only exists on the ESP32.
+ */
+
+#include "Telemetry.h"
+#include <string.h>
+
+#ifdef ARDUINO
+    #include <Arduino.h>
+    #include <driver/uart.h>
+
+    RTC_DATA_ATTR Telemetry_Metrics_t   telemetry_metrics ;                                    // In RTC memory so sequence and wake causes
+#else                                                                                           // survive deep sleep
+    Telemetry_Metrics_t                 telemetry_metrics ;
+#endif
+
+/* State Variables */
+static uint32_t     loopCount ;
+static uint32_t     loopMin_us      = UINT32_MAX ;
+static uint32_t     loopMax_us ;
+static uint64_t     loopTotal_us ;
+#ifdef ARDUINO
+static uint32_t     previousMillis_Telemetry ;
+#endif
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/* Function Definitions */
+
+uint16_t telemetry_crc16(uint8_t const *data, size_t length) {                                 // CRC-16/CCITT-FALSE, nibble table so it costs
+    static uint16_t const table[16] = {                                                         // 32 bytes instead of 512.
+        0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+        0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF
+    } ;
+    uint16_t crc = 0xFFFF ;
+
+    while (length--) {
+        crc = (crc << 4) ^ table[(crc >> 12) ^ (*data >> 4)] ;
+        crc = (crc << 4) ^ table[(crc >> 12) ^ (*data & 0x0F)] ;
+        data++ ;
+    }
+    return crc ;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+size_t telemetry_cobs_encode(uint8_t const *input, size_t length, uint8_t *output) {           // Consistent Overhead Byte Stuffing: removes
+    size_t  code_index  = 0 ;                                                                   // every 0x00 so it can delimit frames. Returns
+    size_t  out_index   = 1 ;                                                                   // the encoded length (without the delimiter).
+    uint8_t code        = 1 ;
+
+    for (size_t i = 0 ; i < length ; i++) {
+        if (input[i] == 0) {
+            output[code_index] = code ;
+            code_index         = out_index++ ;
+            code               = 1 ;
+        }
+        else {
+            output[out_index++] = input[i] ;
+            code++ ;
+            if (code == 0xFF) {
+                output[code_index] = code ;
+                code_index         = out_index++ ;
+                code               = 1 ;
+            }
+        }
+    }
+    output[code_index] = code ;
+    return out_index ;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+size_t telemetry_frame(Telemetry_Metrics_t const *metrics, uint8_t *frame) {                   // Builds a complete, delimited frame in frame[]
+    uint8_t  raw[sizeof(Telemetry_Metrics_t) + 2] ;                                             // (at least TELEMETRY_FRAME_MAX bytes).
+    uint16_t crc ;
+    size_t   length ;
+
+    memcpy(raw, metrics, sizeof(Telemetry_Metrics_t)) ;
+    crc = telemetry_crc16(raw, sizeof(Telemetry_Metrics_t)) ;
+    raw[sizeof(Telemetry_Metrics_t)]     = (uint8_t)(crc & 0xFF) ;
+    raw[sizeof(Telemetry_Metrics_t) + 1] = (uint8_t)(crc >> 8) ;
+
+    length          = telemetry_cobs_encode(raw, sizeof(raw), frame) ;
+    frame[length++] = 0x00 ;
+    return length ;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void telemetry_record_loop(uint32_t elapsed_us) {                                               // Accumulates loop() timing for this period
+    loopCount++ ;
+    loopTotal_us += elapsed_us ;
+    if (elapsed_us < loopMin_us) loopMin_us = elapsed_us ;
+    if (elapsed_us > loopMax_us) loopMax_us = elapsed_us ;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void telemetry_record_wake(uint32_t cause) {                                                    // Counts a wakeup by esp_sleep_wakeup_cause_t
+    if (cause >= TELEMETRY_WAKE_CAUSES) {
+        cause = 0 ;                                                                             // Unknown causes land in ESP_SLEEP_WAKEUP_UNDEFINED
+    }
+    telemetry_metrics.wakeCauses[cause]++ ;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifdef ARDUINO
+void telemetry_init(void) {                                                                     // TX-only UART with a ring buffer large enough
+    uart_config_t const config = {                                                              // for a few frames, so uart_write_bytes() is a
+        .baud_rate              = TELEMETRY_BAUD,                                               // copy and the FIFO interrupt does the rest.
+        .data_bits              = UART_DATA_8_BITS,
+        .parity                 = UART_PARITY_DISABLE,
+        .stop_bits              = UART_STOP_BITS_1,
+        .flow_ctrl              = UART_HW_FLOWCTRL_DISABLE,
+        .rx_flow_ctrl_thresh    = 0,
+        .source_clk             = UART_SCLK_APB
+    } ;
+    uart_driver_install((uart_port_t)TELEMETRY_UART, 2 * UART_FIFO_LEN, 4 * TELEMETRY_FRAME_MAX, 0, NULL, 0) ;
+    uart_param_config((uart_port_t)TELEMETRY_UART, &config) ;
+    uart_set_pin((uart_port_t)TELEMETRY_UART, TELEMETRY_TX_PIN, UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE) ;
+
+    telemetry_metrics.version   = TELEMETRY_VERSION ;
+    previousMillis_Telemetry    = millis() ;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void telemetry_service(uint32_t currentMillis) {                                                // Call every loop(); sends one frame per period
+    uint8_t frame[TELEMETRY_FRAME_MAX] ;
+
+    if ( (currentMillis - previousMillis_Telemetry) < TELEMETRY_PERIOD ) {
+        return ;
+    }
+    previousMillis_Telemetry = currentMillis ;
+
+    telemetry_metrics.uptime_ms     = currentMillis ;
+    telemetry_metrics.loopCount     = loopCount ;
+    telemetry_metrics.loopMin_us    = loopCount ? loopMin_us : 0 ;
+    telemetry_metrics.loopMax_us    = loopMax_us ;
+    telemetry_metrics.loopAvg_us    = loopCount ? (uint32_t)(loopTotal_us / loopCount) : 0 ;
+
+    uart_write_bytes((uart_port_t)TELEMETRY_UART, (char const *)frame, telemetry_frame(&telemetry_metrics, frame)) ;
+    telemetry_metrics.sequence++ ;
+
+    loopCount       = 0 ;                                                                       // Start the next period
+    loopMin_us      = UINT32_MAX ;
+    loopMax_us      = 0 ;
+    loopTotal_us    = 0 ;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void telemetry_flush(void) {                                                                    // Drain the TX buffer before sleeping, or the
+    uart_wait_tx_done((uart_port_t)TELEMETRY_UART, pdMS_TO_TICKS(TELEMETRY_PERIOD)) ;           // last frame is cut off on the wire.
+}
+#endif
@@ -0,0 +1,76 @@
+/*
+ * Name: Telemetry
+ * Description: Framed binary telemetry. The firmware writes its counters into
+ *              telemetry_metrics as plain stores; every TELEMETRY_PERIOD ms
+ *              telemetry_service() snapshots the struct, appends a CRC-16,
+ *              COBS-encodes it and hands the frame to the UART driver, whose
+ *              TX ring buffer and FIFO interrupt drain it in the background.
+ *              tools/telemetry_decode.py turns the stream into CSV or JSON.
+ *
+ * Frame on the wire:   COBS( Telemetry_Metrics_t || CRC-16/CCITT-FALSE (LE) ) 0x00
+ * Target: Espressif ESP32 dev board (framing also builds on the host)
+ */
+
+#ifndef TELEMETRY_H_
+#define TELEMETRY_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Configuration (override with build_flags) */
+#ifndef TELEMETRY_UART
+    #define TELEMETRY_UART          (2)                                                         // UART2 keeps UART0 free for the Serial console
+#endif
+#ifndef TELEMETRY_TX_PIN
+    #define TELEMETRY_TX_PIN        (4)                                                         // Not used by any LED or the button
+#endif
+#ifndef TELEMETRY_BAUD
+    #define TELEMETRY_BAUD          (921600)
+#endif
+#ifndef TELEMETRY_PERIOD
+    #define TELEMETRY_PERIOD        (1000)                                                      // ms between frames
+#endif
+
+#define TELEMETRY_VERSION           (3)                                                         // Bump when Telemetry_Metrics_t changes
+#define TELEMETRY_WAKE_CAUSES       (12)                                                        // Indexed by esp_sleep_wakeup_cause_t
+
+/* Enumerations and Structures */
+typedef struct __attribute__((packed)) {                                                        // Mirrored by METRICS_FORMAT in telemetry_decode.py
+    uint8_t     version ;
+    uint8_t     state ;                                                                         // Current lab state (0 - 4)
+    uint16_t    sequence ;                                                                      // Frame counter, survives deep sleep
+    uint32_t    uptime_ms ;
+    uint32_t    buttonCount ;
+    uint32_t    buttonEdgesAccepted ;
+    uint32_t    buttonEdgesSuppressed ;                                                         // Bounce edges kept from the ISR
+    uint16_t    wakeCauses[TELEMETRY_WAKE_CAUSES] ;
+    uint32_t    loopCount ;                                                                     // loop() iterations in the last period
+    uint32_t    loopMin_us ;
+    uint32_t    loopMax_us ;
+    uint32_t    loopAvg_us ;
+    uint32_t    bootPreApp_us ;                                                                 // See BootTiming.h, BOOT_TIME_UNKNOWN if unknown
+    uint32_t    bootAppInit_us ;
+    uint32_t    bootToFirstOutput_us ;
+    uint32_t    bootTotal_us ;
+    uint16_t    battery_mV ;                                                                    // See BatteryGovernor.h
+    uint8_t     batteryLevel ;                                                                  // Battery_Level_t
+    uint8_t     batteryAction ;                                                                 // Battery_Action_t, latest governor decision
+} Telemetry_Metrics_t ;
+
+#define TELEMETRY_FRAME_MAX         (sizeof(Telemetry_Metrics_t) + 2 + 1 + 1)                   // CRC, one COBS code byte (< 254 bytes) and delimiter
+
+/* Live metrics, written directly by the application */
+extern Telemetry_Metrics_t telemetry_metrics ;
+
+/* Function Prototypes */
+void        telemetry_init(void) ;
+void        telemetry_record_loop(uint32_t elapsed_us) ;
+void        telemetry_record_wake(uint32_t cause) ;
+void        telemetry_service(uint32_t currentMillis) ;
+void        telemetry_flush(void) ;
+
+uint16_t    telemetry_crc16(uint8_t const *data, size_t length) ;
+size_t      telemetry_cobs_encode(uint8_t const *input, size_t length, uint8_t *output) ;
+size_t      telemetry_frame(Telemetry_Metrics_t const *metrics, uint8_t *frame) ;
+
+#endif /* TELEMETRY_H_ */
@@ -0,0 +1,138 @@
+/*
+ * Name: TouchInput
+ * Description: See TouchInput.h. The calibration and threshold half is plain
+ *              C so the host tools can replay recorded readings through it;
+ *              the touch sensor half only exists on the ESP32.
+ */
+
+#include "TouchInput.h"
+#include <string.h>
+
+#ifdef ARDUINO
+    #include <Arduino.h>
+    #include <esp_sleep.h>
+
+    /* State Variables */
+    RTC_DATA_ATTR static Touch_Channel_t    channels[TOUCH_MAX_PADS] ;                          // Baselines survive deep sleep
+    static touch_pad_t                      touchPads[TOUCH_MAX_PADS] ;
+    static uint8_t                          touchCount ;
+    static uint32_t                         sampleInterval_ms ;
+    static uint32_t                         previousMillis_Touch ;
+    static Touch_Config_t const             touchConfig = TOUCH_CONFIG_DEFAULT ;
+#endif
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/* Function Definitions */
+
+void touch_channel_reset(Touch_Channel_t *channel) {                                            // Forget the baseline and calibrate again
+    memset(channel, 0, sizeof(*channel)) ;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool touch_channel_calibrated(Touch_Channel_t const *channel, Touch_Config_t const *config) {
+    return channel->calCount >= config->calSamples ;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+uint16_t touch_channel_baseline(Touch_Channel_t const *channel) {
+    return channel->baseline_q8 >> 8 ;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+uint16_t touch_channel_threshold(Touch_Channel_t const *channel, Touch_Config_t const *config) {    // Reading below this is a touch
+    return (uint32_t)touch_channel_baseline(channel) * (100 - config->thresholdPct) / 100 ;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+Touch_Event_t touch_channel_update(Touch_Channel_t *channel, Touch_Config_t const *config, uint16_t reading) {
+    channel->reading = reading ;
+    if (!touch_channel_calibrated(channel, config)) {                                           // Average the first readings into the baseline
+        channel->calSum += reading ;
+        channel->calCount++ ;
+        if (touch_channel_calibrated(channel, config)) {
+            channel->baseline_q8 = ((uint64_t)channel->calSum << 8) / config->calSamples ;
+        }
+        return TOUCH_NONE ;
+    }
+
+    uint32_t const baseline     = touch_channel_baseline(channel) ;
+    uint32_t const pressLevel   = touch_channel_threshold(channel, config) ;
+    uint32_t const releaseLevel = baseline * (100 - config->thresholdPct + config->hysteresisPct) / 100 ;
+
+    if (channel->touched) {                                                                     // Baseline frozen while touched
+        if (reading > releaseLevel) {
+            channel->touched = false ;
+            return TOUCH_RELEASE ;
+        }
+        return TOUCH_NONE ;
+    }
+    if (reading < pressLevel) {
+        channel->touched = true ;
+        return TOUCH_PRESS ;
+    }
+    int32_t const error = ((int32_t)reading << 8) - (int32_t)channel->baseline_q8 ;             // Untouched: follow slow drift
+    channel->baseline_q8 += error >> config->driftShift ;
+    return TOUCH_NONE ;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifdef ARDUINO
+void touch_input_init(touch_pad_t const *pads, uint8_t count, uint32_t interval_ms) {           // The sensor FSM measures every pad each
+    uint32_t sleepCycles = interval_ms * (TOUCH_RTC_SLOW_HZ / 1000) ;                           // interval_ms on its own, awake or asleep.
+    if (sleepCycles > 0xFFFF) {
+        sleepCycles = 0xFFFF ;                                                                  // ~436 ms is the longest the timer allows
+    }
+    touchCount          = (count > TOUCH_MAX_PADS) ? TOUCH_MAX_PADS : count ;
+    sampleInterval_ms   = (interval_ms > 0) ? interval_ms : 1 ;
+
+    touch_pad_init() ;
+    touch_pad_set_voltage(TOUCH_HVOLT_2V7, TOUCH_LVOLT_0V5, TOUCH_HVOLT_ATTEN_1V) ;
+    touch_pad_set_meas_time(sleepCycles, TOUCH_MEAS_CYCLES) ;
+    touch_pad_set_fsm_mode(TOUCH_FSM_MODE_TIMER) ;
+    for (uint8_t i = 0 ; i < touchCount ; i++) {
+        touchPads[i] = pads[i] ;
+        touch_pad_config(pads[i], 0) ;                                                          // Threshold is set when arming the wake
+    }
+    previousMillis_Touch = millis() ;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+uint8_t touch_input_service(uint32_t currentMillis) {                                           // Call every loop(); reads the latest
+    uint8_t pressed = 0 ;                                                                       // measurement once per interval.
+
+    if ( (currentMillis - previousMillis_Touch) < sampleInterval_ms ) {
+        return 0 ;
+    }
+    previousMillis_Touch = currentMillis ;
+    for (uint8_t i = 0 ; i < touchCount ; i++) {
+        uint16_t reading ;
+        if (touch_pad_read_raw_data(touchPads[i], &reading) != ESP_OK || reading == 0) {
+            continue ;                                                                          // No measurement finished yet
+        }
+        if (touch_channel_update(&channels[i], &touchConfig, reading) == TOUCH_PRESS) {
+            pressed |= 1 << i ;
+        }
+    }
+    return pressed ;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool touch_input_touched(uint8_t index) {
+    return (index < touchCount) && channels[index].touched ;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+void touch_input_arm_wake(void) {                                                               // Wake when any calibrated pad drops below
+    bool armed = false ;                                                                        // its threshold.
+    for (uint8_t i = 0 ; i < touchCount ; i++) {
+        if (touch_channel_calibrated(&channels[i], &touchConfig)) {
+            touch_pad_config(touchPads[i], touch_channel_threshold(&channels[i], &touchConfig)) ;
+            armed = true ;
+        }
+    }
+    if (armed) {
+        touch_pad_set_trigger_mode(TOUCH_TRIGGER_BELOW) ;
+        esp_sleep_enable_touchpad_wakeup() ;
+    }
+}
+#endif
@@ -0,0 +1,74 @@
+/*
+ * Name: TouchInput
+ * Description: Capacitive touch pads as presses and as a sleep wake source.
+ *              On the ESP32 a touch lowers the pad's reading, so each pad
+ *              keeps a baseline of its untouched reading:
+ *
+ *                  calibration     the first calSamples readings are averaged
+ *                  drift           while untouched the baseline follows the
+ *                                  reading with a 1/2^driftShift IIR, so
+ *                                  temperature and humidity do not add up
+ *                                  to a false touch; it freezes while touched
+ *                  threshold       touched below baseline - thresholdPct %,
+ *                                  released above baseline - (thresholdPct -
+ *                                  hysteresisPct) %
+ *
+ *              The hardware measures on its own timer every interval_ms; a
+ *              longer interval lowers the sleep current and raises the wake
+ *              latency. Baselines sit in RTC memory, so a pad that is still
+ *              being touched after a touch wake is not calibrated as idle.
+ * Target: Espressif ESP32 dev board (threshold logic also builds on the host)
+ */
+
+#ifndef TOUCH_INPUT_H_
+#define TOUCH_INPUT_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Configuration */
+#define TOUCH_MAX_PADS          (4)
+#define TOUCH_MEAS_CYCLES       (0x1000)                                                        // 8 MHz cycles per measurement (~0.5 ms)
+#define TOUCH_RTC_SLOW_HZ       (150000)                                                        // Measurement timer clock
+
+/* Enumerations and Structures */
+typedef enum {
+    TOUCH_NONE ,
+    TOUCH_PRESS ,
+    TOUCH_RELEASE
+} Touch_Event_t ;
+
+typedef struct {
+    uint8_t     thresholdPct ;                                                                  // Drop below baseline that counts as a touch
+    uint8_t     hysteresisPct ;                                                                 // Less drop needed to stay touched
+    uint8_t     driftShift ;                                                                    // Baseline IIR weight 1/2^driftShift
+    uint16_t    calSamples ;                                                                    // Readings averaged into the first baseline
+} Touch_Config_t ;
+
+#define TOUCH_CONFIG_DEFAULT    { 20, 5, 6, 16 }
+
+typedef struct {
+    uint32_t    baseline_q8 ;                                                                   // Baseline in 1/256 counts
+    uint32_t    calSum ;
+    uint16_t    calCount ;                                                                      // == calSamples once calibrated
+    uint16_t    reading ;                                                                       // Latest raw reading
+    bool        touched ;
+} Touch_Channel_t ;
+
+/* Function Prototypes */
+void            touch_channel_reset(Touch_Channel_t *channel) ;
+Touch_Event_t   touch_channel_update(Touch_Channel_t *channel, Touch_Config_t const *config, uint16_t reading) ;
+bool            touch_channel_calibrated(Touch_Channel_t const *channel, Touch_Config_t const *config) ;
+uint16_t        touch_channel_baseline(Touch_Channel_t const *channel) ;
+uint16_t        touch_channel_threshold(Touch_Channel_t const *channel, Touch_Config_t const *config) ;
+
+#ifdef ARDUINO
+#include <driver/touch_pad.h>
+
+void            touch_input_init(touch_pad_t const *pads, uint8_t count, uint32_t interval_ms) ;
+uint8_t         touch_input_service(uint32_t currentMillis) ;                                   // Returns the pads newly touched, one bit each
+bool            touch_input_touched(uint8_t index) ;
+void            touch_input_arm_wake(void) ;
+#endif
+
+#endif /* TOUCH_INPUT_H_ */
@@ -38,6 +38,7 @@
 #include "main.h"
 #include <Arduino.h>
 #include <stdint.h>
+#include <stdarg.h>
 
 /* TARGET SELECTION */
 #if 1
@@ -48,44 +49,180 @@
 
 /* SETUP */
 void setup() {
-    Serial.begin(115200) ;
+    boot_mark_setup() ;
+    #ifndef FAST_BOOT
+    console() ;                                                                             // Fast boot leaves the serial port for first use
+    #endif
     pinMode(LED2_B, OUTPUT) ;
     pinMode(LED1_B, OUTPUT) ;
     pinMode(LED1_G, OUTPUT) ;
     pinMode(LED1_R, OUTPUT) ;
     pinMode(BUTTON1, INPUT_PULLUP) ;
+    #ifdef RGB_LED_FADE
+    rgb_init(LED1_R, LED1_G, LED1_B, LED_ON == LOW) ;                                       // LED1 moves to LEDC; active LOW is inverted in hardware
+    #endif
+    LED_init() ;                                                                            // Set all LEDs to OFF position
+    boot_mark_first_output() ;                                                              // Everything below can wait until the LEDs are right
+
+    telemetry_init() ;                                                                      // Binary telemetry on its own UART
+    if ( esp_sleep_get_wakeup_cause() != ESP_SLEEP_WAKEUP_UNDEFINED ) {                     // Count the wake from deep sleep that got us here
+        telemetry_record_wake(esp_sleep_get_wakeup_cause()) ;
+    }
 
+    button_init() ;                                                                         // Rearm timer and optional glitch filter
     attachInterrupt(digitalPinToInterrupt(BUTTON1), ISR_buttonPressed, RISING) ;
+    #ifdef KEY_MATRIX_INPUT
+    keymatrix_init(KEY_ROWS, sizeof(KEY_ROWS), KEY_COLS, sizeof(KEY_COLS)) ;                // Idles on one interrupt for every column
+    #endif
+    #ifdef TOUCH_INPUT
+    touch_input_init(TOUCH_PADS, sizeof(TOUCH_PADS) / sizeof(TOUCH_PADS[0]), TOUCH_INTERVAL) ;  // Calibrates on the first readings after a cold boot
+    #endif
+    #ifdef BATTERY_GOVERNOR
+    battery_init() ;                                                                        // First supply reading within a few ms
+    #endif
 
-    LED_init() ;                                                                            // Set all LEDs to OFF position
     // buttonCount             = 0 ;                                                        // Uninitialized static variables are set to zero in C
     previousMillis_Btn      = 0 ;
     previousMillis_Blink1   = 0 ;
     previousMillis_Blink2   = 0 ;   
+
+    profiler_init(LOOP_BUDGET_US, LOOP_WATCHDOG_S) ;                                        // Time every loop() and guard it with the watchdog
+
+    boot_mark_setup_done() ;                                                                // Boot phases go out with every telemetry frame
+    telemetry_metrics.bootPreApp_us         = boot_timing.preApp_us ;
+    telemetry_metrics.bootAppInit_us        = boot_timing.appInit_us ;
+    telemetry_metrics.bootToFirstOutput_us  = boot_timing.toFirstOutput_us ;
+    telemetry_metrics.bootTotal_us          = boot_timing.total_us ;
+    #ifndef FAST_BOOT
+    boot_report(console()) ;
+    #endif
+    #ifdef ALLOC_TRACKER
+    alloc_tracker_arm() ;                                                                   // From here on the heap is off limits
+    #endif
+}
+
+/* CONSOLE */
+HardwareSerial &console(void) {                                                             // Serial is only started the first time something
+    static bool started = false ;                                                           // prints, so wakes that never print skip it.
+    if (!started) {
+        Serial.begin(115200) ;
+        started = true ;
+    }
+    return Serial ;
+}
+
+void console_printf(char const *format, ...) {                                              // printf through a static buffer; Print::printf
+    static char buffer[128] ;                                                               // goes to the heap past 64 characters.
+    va_list     args ;
+
+    va_start(args, format) ;
+    int const length = vsnprintf(buffer, sizeof(buffer), format, args) ;
+    va_end(args) ;
+    if ( length > 0 ) {
+        console().write((uint8_t const *)buffer, min((size_t)length, sizeof(buffer) - 1)) ;
+    }
 }
 
 /* MAIN */
 void loop() {
+    profiler_loop_begin() ;
+    uint32_t const loopStart_us = micros() ;
     currentMillis = millis() ;                                                              // Get current time
 
+    uint8_t presses = 0 ;                                                                   // Presses from every source this iteration
+    #ifdef KEY_MATRIX_INPUT
+    keymatrix_service(currentMillis) ;                                                      // Scans only while a key is bouncing or held
+    KeyEvent_t keyEvent ;
+    while ( keymatrix_get_event(&keyEvent) ) {
+        if ( keyEvent.down ) {
+            presses++ ;
+            console_printf("Key %u pressed\n", keyEvent.key) ;
+        }
+    }
+    #endif
+    #ifdef TOUCH_INPUT
+    if ( touch_input_service(currentMillis) ) {                                             // Any pad newly touched is one press
+        presses++ ;
+    }
+    #endif
+    if ( buttonPressPending ) {                                                             // The ISR only flags the press: buttonCount is
+        buttonPressPending = false ;                                                        // written below and nowhere else, and printing
+        presses++ ;                                                                         // stays here because Serial lives in flash.
+    }
+
+    if ( presses ) {
+        buttonCount += presses ;
+        previousMillis_Press = currentMillis ;
+        PROFILE_SCOPE("button printf") ;
+        console_printf("Button has been pressed %u times\n", buttonCount) ;
+    }
+
+    #ifdef BATTERY_GOVERNOR
+    battery_service(currentMillis) ;                                                        // Collects a DMA frame once per BATTERY_PERIOD
+    telemetry_metrics.battery_mV    = battery.mV ;
+    telemetry_metrics.batteryLevel  = battery.level ;
+    switch ( battery_governor_decide(&battery, &battery_config, currentMillis - previousMillis_Press) ) {
+        case BATTERY_ACTION_DEEP_SLEEP  :                                                   // Critical: sleep now, state 4's wake sources
+            telemetry_metrics.batteryAction = BATTERY_ACTION_DEEP_SLEEP ;
+            telemetry_metrics.state         = 4 ;
+            console_printf("Battery critical (%u mV)\n", battery.mV) ;
+            change_to_state4() ;
+            break ;
+        case BATTERY_ACTION_LIGHT_SLEEP :                                                   // Low and idle: light sleep until a press
+            telemetry_metrics.batteryAction = BATTERY_ACTION_LIGHT_SLEEP ;
+            console_printf("Battery low (%u mV), idle\n", battery.mV) ;
+            change_to_state3() ;
+            previousMillis_Press = millis() ;
+            break ;
+        default :
+            telemetry_metrics.batteryAction = battery.action ;
+            break ;
+    }
+    #endif
+
     if ( !(buttonCount % 7) ) {                                                             // Reset LEDs to OFF state
+        PROFILE_SCOPE("LED_init") ;
         LED_init() ;
         buttonCount = 0 ;
+        telemetry_metrics.state = 0 ;
     }
     else if ( !(buttonCount % 5) ) {                                                        // Go to deep sleep mode
+        telemetry_metrics.state = 4 ;
+        PROFILE_SCOPE("change_to_state4") ;
         change_to_state4() ;
     }
     else if ( !(buttonCount % 3) ) {                                                        // Go to light sleep mode
+        telemetry_metrics.state = 3 ;
+        PROFILE_SCOPE("change_to_state3") ;
         change_to_state3() ;
     }
 
     else if ( !(buttonCount % 2) ) {                                                        // Flash red LED ON for 50ms with 1s cycle
+        telemetry_metrics.state = 2 ;
+        PROFILE_SCOPE("change_to_state2") ;
         change_to_state2(currentMillis) ;
     }
     else {
+        telemetry_metrics.state = 1 ;
+        PROFILE_SCOPE("change_to_state1") ;
         change_to_state1() ;                                                                // Turn blue LED ON and keep at steady state
     }
 
+    telemetry_metrics.buttonCount           = buttonCount ;                                 // Plain stores; telemetry_service() frames them
+    telemetry_metrics.buttonEdgesAccepted   = buttonEdgesAccepted ;                         // once per TELEMETRY_PERIOD
+    telemetry_metrics.buttonEdgesSuppressed = buttonEdgesSuppressed ;
+    {
+        PROFILE_SCOPE("telemetry_service") ;
+        telemetry_service(currentMillis) ;
+    }
+    #ifdef RGB_LED_FADE
+    rgb_service() ;                                                                         // Start any latched LED1 color change
+    #endif
+    #ifdef ALLOC_TRACKER
+    alloc_tracker_report(console()) ;                                                       // Only prints if the loop allocated
+    #endif
+    telemetry_record_loop(micros() - loopStart_us) ;
+    profiler_loop_end() ;
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -98,9 +235,13 @@ void LED_init(void) {
     redLED_state    = LED_OFF ;
 
     digitalWrite(LED2_B, blueLED2_state) ;
+    #ifdef RGB_LED_FADE
+    rgb_fade_to(RGB_OFF, RGB_FADE_TIME) ;
+    #else
     digitalWrite(LED1_B, blueLED1_state) ;
     digitalWrite(LED1_G, greenLED_state) ;
     digitalWrite(LED1_R, redLED_state) ;
+    #endif
 }
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 #if 0
@@ -120,74 +261,167 @@ void change_to_state1(void) {
     blueLED1_state  = LED_ON ;                                                              // LED to an ON steady state
     redLED_state    = LED_OFF ;
     
+    #ifdef RGB_LED_FADE
+    rgb_fade_to(RGB_BLUE, RGB_FADE_TIME) ;                                                  // Fades in once; repeat calls are free
+    #else
     digitalWrite(LED1_B, blueLED1_state) ;
     digitalWrite(LED1_R, redLED_state) ;
+    #endif
 }
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 void change_to_state2(uint32_t currentMillis) {                                             // On every (7n+2) button press, have the blue LED
     blueLED1_state  = LED_OFF ;                                                             // in the OFF position, but flash on the red LED
-    digitalWrite(LED1_B, blueLED1_state) ;                                                  // for 50ms with total cycle time of 1s.
+    #ifndef RGB_LED_FADE                                                                    // for 50ms with total cycle time of 1s.
+    digitalWrite(LED1_B, blueLED1_state) ;
+    #endif
 
-    if ( (currentMillis - previousMillis_Blink1) >= BLINK1_DELAY ) {                        // Turn red LED ON for 50ms
+    #ifdef BATTERY_GOVERNOR
+    uint32_t const blink1Delay = battery_on_time(battery.level, BLINK1_DELAY) ;             // Shorter on-time as the battery drains
+    #else
+    uint32_t const blink1Delay = BLINK1_DELAY ;
+    #endif
+
+    if ( (currentMillis - previousMillis_Blink1) >= blink1Delay ) {                         // Turn red LED ON for 50ms
         redLED_state = LED_OFF ;
+        #ifdef RGB_LED_FADE
+        rgb_set(RGB_OFF) ;
+        #else
         digitalWrite(LED1_R, redLED_state) ;
-        previousMillis_Blink1 += BLINK1_DELAY ;
+        #endif
+        previousMillis_Blink1 += blink1Delay ;
     }
     if ( (currentMillis - previousMillis_Blink2) >= BLINK2_DELAY ) {                        // Turn red LED OFF for 950ms
         redLED_state = LED_ON ;
+        #ifdef RGB_LED_FADE
+        rgb_set(RGB_RED) ;
+        #else
         digitalWrite(LED1_R, redLED_state) ;
+        #endif
         previousMillis_Blink2 += BLINK2_DELAY ;
+        #ifdef BATTERY_GOVERNOR
+        previousMillis_Blink1  = previousMillis_Blink2 ;                                    // On-time counts from here even if it changed
+        #endif
     }
 }
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 void change_to_state3() {                                                                   // Put the device in light sleep mode.
     LED_init() ;
-    Serial.println("Enabling light sleep mode...") ;
+    console().println("Enabling light sleep mode...") ;
+    #ifdef RGB_LED_FADE
+    rgb_fade_wait(pdMS_TO_TICKS(RGB_FADE_TIME)) ;                                           // LEDC stops in light sleep, so finish any fade
+    rgb_service() ;                                                                         // in progress, start the one to OFF and let it
+    rgb_fade_wait(pdMS_TO_TICKS(RGB_FADE_TIME)) ;                                           // finish before going down.
+    #endif
+    #ifdef TOUCH_INPUT
+    esp_sleep_enable_ext1_wakeup(1ULL << BUTTON1, ESP_EXT1_WAKEUP_ALL_LOW) ;                // ext0 and touch cannot be armed together on the
+    touch_input_arm_wake() ;                                                                // ESP32, so the button moves to ext1.
+    #else
     esp_sleep_enable_ext0_wakeup(BUTTON1, BUTTON_ON) ;                                      // Configures light sleep wakeup sources (GPIO)
-                                                                                            // then puts the ESP32 into light sleep mode.
+    #endif
+    telemetry_flush() ;                                                                     // then puts the ESP32 into light sleep mode.
     esp_light_sleep_start() ;                                                               // Prints wakeup reason when woken up.
 
     wakeup_reason = esp_sleep_get_wakeup_cause() ;
+    telemetry_record_wake(wakeup_reason) ;
     switch(wakeup_reason)
     {
-        case ESP_SLEEP_WAKEUP_EXT0      : Serial.println("Wakeup caused by external signal using RTC_IO") ;             break ;
-        case ESP_SLEEP_WAKEUP_EXT1      : Serial.println("Wakeup caused by external signal using RTC_CNTL") ;           break ;
-        case ESP_SLEEP_WAKEUP_TIMER     : Serial.println("Wakeup caused by timer") ;                                    break ;
-        case ESP_SLEEP_WAKEUP_TOUCHPAD  : Serial.println("Wakeup caused by touchpad") ;                                 break ;
-        case ESP_SLEEP_WAKEUP_ULP       : Serial.println("Wakeup caused by ULP program") ;                              break ;
-        default                         : Serial.printf("Wakeup was not caused by deep sleep: %d\n",wakeup_reason) ;    break ;
+        case ESP_SLEEP_WAKEUP_EXT0      : console().println("Wakeup caused by external signal using RTC_IO") ;          break ;
+        case ESP_SLEEP_WAKEUP_EXT1      : console().println("Wakeup caused by external signal using RTC_CNTL") ;        break ;
+        case ESP_SLEEP_WAKEUP_TIMER     : console().println("Wakeup caused by timer") ;                                 break ;
+        case ESP_SLEEP_WAKEUP_TOUCHPAD  : console().println("Wakeup caused by touchpad") ;                              break ;
+        case ESP_SLEEP_WAKEUP_ULP       : console().println("Wakeup caused by ULP program") ;                           break ;
+        default                         : console_printf("Wakeup was not caused by deep sleep: %d\n", wakeup_reason) ;  break ;
     }
 }
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 void change_to_state4() {                                                                   // Put the device in deep sleep mode.
+    #ifdef FAST_BOOT
+    esp_deep_sleep_disable_rom_logging() ;                                                  // No ROM boot banner on the way back up
+    #endif
+    #ifdef TOUCH_INPUT
+    esp_sleep_enable_ext1_wakeup(1ULL << BUTTON1, ESP_EXT1_WAKEUP_ALL_LOW) ;                // Button on ext1, pads keep measuring every
+    touch_input_arm_wake() ;                                                                // TOUCH_INTERVAL in deep sleep.
+    #else
     esp_sleep_enable_ext0_wakeup(BUTTON1, BUTTON_ON) ;                                      // Configures deep sleep wakeup sources (GPIO)
-                                                                                            // then puts the ESP32 into deep sleep mode.
+    #endif
+    telemetry_flush() ;                                                                     // then puts the ESP32 into deep sleep mode.
     esp_deep_sleep_start() ;                                                                // Prints wakeup reason when woken up.
-    Serial.println("Enabling deep sleep mode...") ;
+    console().println("Enabling deep sleep mode...") ;
     wakeup_reason = esp_sleep_get_wakeup_cause() ;
     switch(wakeup_reason)
     {
-        case ESP_SLEEP_WAKEUP_EXT0      : Serial.println("Wakeup caused by external signal using RTC_IO") ;             break ;
-        case ESP_SLEEP_WAKEUP_EXT1      : Serial.println("Wakeup caused by external signal using RTC_CNTL") ;           break ;
-        case ESP_SLEEP_WAKEUP_TIMER     : Serial.println("Wakeup caused by timer") ;                                    break ;
-        case ESP_SLEEP_WAKEUP_TOUCHPAD  : Serial.println("Wakeup caused by touchpad") ;                                 break ;
-        case ESP_SLEEP_WAKEUP_ULP       : Serial.println("Wakeup caused by ULP program") ;                              break ;
-        default                         : Serial.printf("Wakeup was not caused by deep sleep: %d\n", wakeup_reason) ;   break ;
+        case ESP_SLEEP_WAKEUP_EXT0      : console().println("Wakeup caused by external signal using RTC_IO") ;          break ;
+        case ESP_SLEEP_WAKEUP_EXT1      : console().println("Wakeup caused by external signal using RTC_CNTL") ;        break ;
+        case ESP_SLEEP_WAKEUP_TIMER     : console().println("Wakeup caused by timer") ;                                 break ;
+        case ESP_SLEEP_WAKEUP_TOUCHPAD  : console().println("Wakeup caused by touchpad") ;                              break ;
+        case ESP_SLEEP_WAKEUP_ULP       : console().println("Wakeup caused by ULP program") ;                           break ;
+        default                         : console_printf("Wakeup was not caused by deep sleep: %d\n", wakeup_reason) ;  break ;
     }
 }
 
 /* Button ISR Handler */
 #ifndef MSP432401R
+    void button_init(void) {                                                                // Creates the one-shot timer that unmasks the
+        esp_timer_create_args_t const rearmArgs = {                                         // button interrupt once the switch has settled.
+            .callback           = button_rearm,
+            .arg                = NULL,
+            .dispatch_method    = ESP_TIMER_TASK,
+            .name               = "btn_rearm"
+        } ;
+        esp_timer_create(&rearmArgs, &buttonRearmTimer) ;
+
+        #ifdef BUTTON_MASK_AND_REARM
+        pcnt_config_t const edgeCounter = {                                                 // PCNT counts both edges on BUTTON1 with no ISR,
+            .pulse_gpio_num     = BUTTON1,                                                  // so the rearm can tell how many edges the mask
+            .ctrl_gpio_num      = PCNT_PIN_NOT_USED,                                        // swallowed. No glitch filter: the bounce is
+            .lctrl_mode         = PCNT_MODE_KEEP,                                           // exactly what it should see.
+            .hctrl_mode         = PCNT_MODE_KEEP,
+            .pos_mode           = PCNT_COUNT_INC,
+            .neg_mode           = PCNT_COUNT_INC,
+            .counter_h_lim      = INT16_MAX,
+            .counter_l_lim      = 0,
+            .unit               = BUTTON_PCNT_UNIT,
+            .channel            = PCNT_CHANNEL_0
+        } ;
+        pcnt_unit_config(&edgeCounter) ;
+        pcnt_counter_clear(BUTTON_PCNT_UNIT) ;
+        #endif
+    }
+    ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+    void button_rearm(void *arg) {                                                          // Runs from the esp_timer task after the settle
+        if ( gpio_get_level((gpio_num_t)BUTTON1) == BUTTON_ON ) {                           // window. A bouncy press can have its first RISING
+            esp_timer_start_once(buttonRearmTimer, (uint64_t)BUTTON_DEBOUNCE * 1000) ;      // edge accepted mid-press; unmasking while it is
+            return ;                                                                        // still held would count the release again, so
+        }                                                                                   // wait for the pin to go idle first.
+        int16_t edges = 0 ;                                                                 // Idle to idle is one press: a clean one is two
+        pcnt_get_counter_value(BUTTON_PCNT_UNIT, &edges) ;                                  // edges, anything past that was bounce the mask
+        pcnt_counter_clear(BUTTON_PCNT_UNIT) ;                                              // kept from the ISR.
+        if ( edges > 2 ) {
+            buttonEdgesSuppressed += edges - 2 ;
+        }
+        gpio_ll_clear_intr_status(&GPIO, BIT(BUTTON1)) ;                                    // Drop the edge latched while masked, or it would
+        gpio_intr_enable(BUTTON1) ;                                                         // fire straight away.
+    }
+    ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
     void IRAM_ATTR ISR_buttonPressed(void) {                                                // This function detects a button press
-        #if 1
+        #ifdef BUTTON_MASK_AND_REARM
+        gpio_ll_intr_disable(&GPIO, BUTTON1) ;                                              // The first edge is the press: mask the pin so the
+        buttonEdgesAccepted++ ;                                                             // rest of the bounce burst never interrupts us, and
+        buttonPressPending = true ;                                                         // let the one-shot timer unmask it once settled;
+        esp_timer_start_once(buttonRearmTimer, (uint64_t)BUTTON_DEBOUNCE * 1000) ;          // loop() counts it. Everything touched here is in
+                                                                                            // IRAM/DRAM; the build fails if that stops being
+                                                                                            // true (tools/check_iram.py).
+        #elif 1
         if ( (currentMillis - previousMillis_Btn) >= (BUTTON_DEBOUNCE) ) {                  // and then debounces the button with the
             previousMillis_Btn += BUTTON_DEBOUNCE ;                                         // millis nonblocking method. It then
-            buttonCount++ ;                                                                 // increments the button counter.
-            
-            Serial.printf("Button has been pressed %u times\n", buttonCount);
+            buttonEdgesAccepted++ ;                                                         // flags the press for loop() to count.
+            buttonPressPending = true ;
+        }
+        else {
+            buttonEdgesSuppressed++ ;
         }
         #else
         debounceButton() ;
@@ -205,4 +439,4 @@ void change_to_state4() {
         }
         // debounceButton() ;
     }
-#endif
\ No newline at end of file
+#endif
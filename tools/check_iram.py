@@ -0,0 +1,202 @@
+"""
+Name: check_iram.py
+Description: PlatformIO post-build step that proves every IRAM_ATTR function
+             in the project only reaches IRAM/ROM code and DRAM data.
+             Starting from each function the project placed in an .iram1.*
+             section, it walks the call graph in the final ELF (direct calls,
+             tail jumps and function pointers loaded from literal pools) and
+             fails the build if anything on the way lives in flash.
+Usage: In platformio.ini
+            extra_scripts           = post:../tools/check_iram.py
+            custom_iram_check_allow = abort, __assert_func      ; optional
+       Symbols in the allow list are treated as leaves and never reported.
+Target: Espressif ESP32 (xtensa-esp32-elf toolchain)
+"""
+
+import os
+import re
+import struct
+import subprocess
+
+Import("env")                                                                               # noqa: F821 (provided by SCons)
+
+# ESP32 memory map (TRM, "System and Memory")
+ROM_RANGE       = (0x40000000, 0x40070000)                                                  # Mask ROM, always available
+IRAM_RANGE      = (0x40070000, 0x400C2000)                                                  # Internal IRAM and RTC fast memory
+IROM_RANGE      = (0x400C2000, 0x40C00000)                                                  # Flash, mapped through the instruction cache
+DROM_RANGE      = (0x3F400000, 0x3F800000)                                                  # Flash, mapped through the data cache
+
+DEFAULT_ALLOW   = ("abort", "__assert_func")                                                # Panic paths; the system is going down anyway
+
+CALL_RE         = re.compile(r"^\s*([0-9a-f]+):\s+[0-9a-f]+\s+(call(?:0|4|8|12)|j)\s+([0-9a-f]{8}) <")
+L32R_RE         = re.compile(r"^\s*([0-9a-f]+):\s+[0-9a-f]+\s+l32r\s+a\d+,\s+([0-9a-f]{8}) <")
+FUNC_RE         = re.compile(r"^([0-9a-f]{8}) <(.+)>:$")
+
+
+def in_range(addr, rng):
+    return rng[0] <= addr < rng[1]
+
+
+def is_flash(addr):
+    return in_range(addr, IROM_RANGE) or in_range(addr, DROM_RANGE)
+
+
+def tool(name):
+    gcc = env.subst("$CC")                                                                  # noqa: F821
+    return gcc[:-len("gcc")] + name if gcc.endswith("gcc") else name
+
+
+def run(*args):
+    return subprocess.run(args, check=True, stdout=subprocess.PIPE, universal_newlines=True,
+                          env=env["ENV"]).stdout                                             # noqa: F821
+
+
+def symbols(path):
+    """Returns {name: (address, section)} for every function symbol in an object or ELF."""
+    table = {}
+    for line in run(tool("objdump"), "-t", path).splitlines():
+        fields = line.split()
+        if len(fields) >= 6 and "F" in fields[1:-3]:
+            table[fields[-1]] = (int(fields[0], 16), fields[-3])
+    return table
+
+
+class Elf32(object):
+    """Just enough of an ELF32 little-endian reader to fetch literal pool words."""
+
+    def __init__(self, path):
+        with open(path, "rb") as f:
+            self.data = f.read()
+        shoff, = struct.unpack_from("<I", self.data, 0x20)
+        shentsize, shnum = struct.unpack_from("<HH", self.data, 0x2E)
+        self.sections = []
+        for i in range(shnum):
+            _, sh_type, _, addr, offset, size = struct.unpack_from("<IIIIII", self.data, shoff + i * shentsize)
+            if sh_type == 1 and addr:                                                       # SHT_PROGBITS with a load address
+                self.sections.append((addr, offset, size))
+
+    def word(self, addr):
+        for base, offset, size in self.sections:
+            if base <= addr and addr + 4 <= base + size:
+                return struct.unpack_from("<I", self.data, offset + addr - base)[0]
+        return None
+
+
+def entry_points(build_dir):
+    """Every function the project itself placed in IRAM with IRAM_ATTR."""
+    entries = set()
+    for root, _, files in os.walk(build_dir):
+        if os.path.relpath(root, build_dir).startswith("FrameworkArduino"):
+            continue
+        for name in files:
+            if name.endswith(".o"):
+                for symbol, (_, section) in symbols(os.path.join(root, name)).items():
+                    if section.startswith(".iram1"):
+                        entries.add(symbol)
+    return entries
+
+
+def call_graph(elf_path):
+    """Returns {function address: (name, [(kind, target address)])} for all IRAM code."""
+    functions   = {}
+    current     = None
+    listing     = run(tool("objdump"), "-d", "-j", ".iram0.vectors", "-j", ".iram0.text", elf_path)
+    for line in listing.splitlines():
+        match = FUNC_RE.match(line)
+        if match:
+            current = int(match.group(1), 16)
+            functions[current] = (match.group(2), [])
+            continue
+        if current is None:
+            continue
+        match = CALL_RE.match(line)
+        if match:
+            functions[current][1].append(("call", int(match.group(3), 16)))
+            continue
+        match = L32R_RE.match(line)
+        if match:
+            functions[current][1].append(("literal", int(match.group(2), 16)))
+    return functions
+
+
+def owner(functions, starts, addr):
+    """Finds the function that contains addr (binary search over sorted starts)."""
+    lo, hi = 0, len(starts)
+    while lo < hi:
+        mid = (lo + hi) // 2
+        if starts[mid] <= addr:
+            lo = mid + 1
+        else:
+            hi = mid
+    return starts[lo - 1] if lo else None
+
+
+def check_iram(source, target, env):
+    elf_path    = target[0].get_abspath()
+    build_dir   = env.subst("$BUILD_DIR")
+    allow       = set(DEFAULT_ALLOW)
+    allow.update(s.strip() for s in env.GetProjectOption("custom_iram_check_allow", "").split(",") if s.strip())
+
+    elf         = Elf32(elf_path)
+    by_name     = symbols(elf_path)
+    names       = dict((addr, name) for name, (addr, _) in by_name.items())
+    functions   = call_graph(elf_path)
+    starts      = sorted(functions)
+
+    entries     = entry_points(build_dir)
+    queue       = []
+    parent      = {}
+    for name in sorted(entries):
+        addr = by_name.get(name, (None,))[0]
+        if addr is None:
+            continue                                                                        # Discarded by --gc-sections
+        if not in_range(addr, IRAM_RANGE):
+            print("check_iram: %s is IRAM_ATTR but linked at 0x%08x" % (name, addr))
+            return 1
+        parent[addr] = None
+        queue.append(addr)
+
+    violations = []
+    while queue:
+        func = queue.pop()
+        _, edges = functions.get(func, (None, []))
+        for kind, addr in edges:
+            if kind == "literal":
+                addr = elf.word(addr)
+                if addr is None:
+                    continue
+            if is_flash(addr):
+                target_name = names.get(addr, "0x%08x" % addr)
+                if target_name not in allow:
+                    violations.append((func, kind, addr, target_name))
+                continue
+            if not in_range(addr, IRAM_RANGE):
+                continue                                                                    # DRAM data or mask ROM: fine
+            if kind == "literal" and addr not in functions:
+                continue                                                                    # IRAM data word, not a function pointer
+            callee = owner(functions, starts, addr)
+            if callee is None or callee == func or callee in parent:
+                continue
+            if functions[callee][0] in allow:
+                continue
+            parent[callee] = func
+            queue.append(callee)
+
+    for func, kind, addr, target_name in violations:
+        chain = []
+        node = func
+        while node is not None:
+            chain.append(functions.get(node, (names.get(node, "0x%08x" % node),))[0])
+            node = parent[node]
+        what = "calls" if kind == "call" else "references"
+        print("check_iram: %s %s flash-resident %s (0x%08x)" % (" -> ".join(reversed(chain)), what, target_name, addr))
+
+    if violations:
+        print("check_iram: %d flash reference(s) reachable from IRAM_ATTR code" % len(violations))
+        return 1
+    print("check_iram: %d IRAM_ATTR entry point(s), %d IRAM function(s) reachable, no flash references"
+          % (len([e for e in entries if e in by_name]), len(parent)))
+    return 0
+
+
+env.AddPostAction("$BUILD_DIR/${PROGNAME}.elf", check_iram)                                  # noqa: F821
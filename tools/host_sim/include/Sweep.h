@@ -0,0 +1,69 @@
+/*
+ * Name: Sweep
+ * Description: Host-side parameter sweep for the lab state machines. Each lab's
+ *              button handling and state selection is replayed against a
+ *              simulated clock and button pin, edge by edge, for every
+ *              combination of BUTTON_DEBOUNCE, BLINK1_DELAY and BLINK2_DELAY
+ *              in the grid. Configurations are ranked by missed presses,
+ *              extra (bounce) presses, press-to-state latency and energy.
+ * Target: Host (PlatformIO native)
+ */
+
+#ifndef SWEEP_H_
+#define SWEEP_H_
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+/* Enumerations and Structures */
+typedef enum {                                                                                  // Which lab's main.cpp to replay
+    LAB_POLL ,                                                                                  // Lab2 Poll:  falling edge seen by loop(), 3 states
+    LAB_ISR ,                                                                                   // Lab2 ISR:   rising edge ISR, millis() debounce, 3 states
+    LAB3                                                                                        // Lab3:       rising edge ISR, mask-and-rearm, 5 states
+} Lab_t ;
+
+typedef struct {                                                                                // One transition of the physical button pin
+    uint64_t    time_us ;
+    uint8_t     level ;                                                                         // LOW (0) = pressed, the buttons are active LOW
+} Edge_t ;
+
+typedef struct {                                                                                // A press trace plus its ground truth
+    std::string             name ;
+    std::vector<Edge_t>     edges ;
+    std::vector<uint64_t>   pressStart_us ;                                                     // First edge of every real press
+    uint64_t                length_us ;
+} Trace_t ;
+
+typedef struct {
+    uint32_t    debounce_ms ;                                                                   // BUTTON_DEBOUNCE
+    uint32_t    blink1_ms ;                                                                     // BLINK1_DELAY (red LED on-time)
+    uint32_t    blink2_ms ;                                                                     // BLINK2_DELAY (blink period)
+} Params_t ;
+
+typedef struct {
+    Params_t    params ;
+    uint32_t    presses ;
+    uint32_t    missed ;                                                                        // Real presses that were never counted
+    uint32_t    extra ;                                                                         // Counts caused by bounce or release edges
+    uint32_t    invalid ;                                                                       // Traces the lab cannot represent (e.g. uint8_t overflow)
+    double      latencyMean_ms ;
+    double      latencyMax_ms ;
+    double      energy_J ;                                                                      // Averaged over traces
+} Result_t ;
+
+typedef struct {                                                                                // Synthetic trace generator settings
+    uint32_t    presses ;
+    uint32_t    gapMin_ms ,     gapMax_ms ;                                                     // Idle time between presses
+    uint32_t    holdMin_ms ,    holdMax_ms ;
+    uint32_t    bouncesMax ;                                                                    // Extra edges on each transition
+    uint32_t    bounceMax_us ;                                                                  // Longest bounce interval
+} Synthetic_t ;
+
+/* Function Prototypes */
+Trace_t     trace_synthetic(Synthetic_t const &config, uint32_t seed) ;
+bool        trace_load(char const *path, uint32_t settle_us, Trace_t &trace) ;
+
+Result_t    lab_simulate(Lab_t lab, Params_t const &params, std::vector<Trace_t> const &traces) ;
+
+#endif /* SWEEP_H_ */
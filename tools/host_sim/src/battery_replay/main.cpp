@@ -0,0 +1,189 @@
+/*
+ * Name: battery_replay
+ * Description: Drives the BatteryGovernor with a simulated or recorded supply
+ *              voltage. The simulated cell is a single LiPo: open-circuit
+ *              voltage from a discharge table, sagging by its internal
+ *              resistance under the load the governor chose (the Lab3 current
+ *              readings), plus ADC noise. It runs until the cell reaches the
+ *              cutoff and reports every level change, the time spent in each
+ *              level and the runtime with and without the governor.
+ *              Recorded curves are "time_s,mV" CSV files and are replayed
+ *              open loop (the load does not feed back); readings outside the
+ *              governor's valid range are counted, not acted on.
+ * Usage: pio run -e battery_replay && .pio/build/battery_replay/program --capacity 100
+ *              --capacity MAH          simulated cell capacity (default 100)
+ *              --press S               seconds between button presses (default 60)
+ *              --noise MV              ADC noise, 1 sigma (default 15)
+ *              --curve FILE            replay a recorded "time_s,mV" CSV instead
+ *              --low MV --critical MV --hysteresis MV --filter SHIFT
+ *                                      governor thresholds (defaults from BATTERY_CONFIG_DEFAULT)
+ * Target: Host (PlatformIO native)
+ */
+
+#include <BatteryGovernor.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <random>
+#include <vector>
+
+/* Constants */
+static double const     CUTOFF_MV           = 3000.0 ;
+static double const     INTERNAL_OHM        = 0.25 ;
+static double const     AWAKE_MA            = 63.5 ;                                            // States 0 - 2, see Lab3 main.cpp
+static double const     LIGHT_SLEEP_MA      = 2.12 ;
+static double const     DEEP_SLEEP_MA       = 0.012 ;
+static double const     SHORT_ON_SAVING_MA  = 0.4 ;                                             // Halved LED on-time in state 2
+static double const     OCV_TABLE[][2]      = {                                                 // State of charge, open-circuit mV
+    { 1.00, 4200 }, { 0.90, 4060 }, { 0.80, 3980 }, { 0.70, 3920 }, { 0.60, 3870 }, { 0.50, 3820 },
+    { 0.40, 3790 }, { 0.30, 3770 }, { 0.20, 3730 }, { 0.10, 3680 }, { 0.05, 3600 }, { 0.02, 3450 },
+    { 0.00, 3000 }
+} ;
+
+/* Enumerations and Structures */
+typedef struct {
+    double      time_s ;
+    double      level_s[3] ;                                                                    // Time spent in each Battery_Level_t
+    uint32_t    transitions ;
+} Run_t ;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/* Function Definitions */
+
+static double open_circuit_mV(double charge) {                                                  // Linear between table rows
+    size_t const rows = sizeof(OCV_TABLE) / sizeof(OCV_TABLE[0]) ;
+    for (size_t i = 1 ; i < rows ; i++) {
+        if (charge >= OCV_TABLE[i][0]) {
+            double const span = (charge - OCV_TABLE[i][0]) / (OCV_TABLE[i - 1][0] - OCV_TABLE[i][0]) ;
+            return OCV_TABLE[i][1] + span * (OCV_TABLE[i - 1][1] - OCV_TABLE[i][1]) ;
+        }
+    }
+    return OCV_TABLE[rows - 1][1] ;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static double action_mA(Battery_Action_t action) {
+    switch (action) {
+        case BATTERY_ACTION_SHORT_ON    : return AWAKE_MA - SHORT_ON_SAVING_MA ;
+        case BATTERY_ACTION_LIGHT_SLEEP : return LIGHT_SLEEP_MA ;
+        case BATTERY_ACTION_DEEP_SLEEP  : return DEEP_SLEEP_MA ;
+        default                         : return AWAKE_MA ;
+    }
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static Run_t simulate(Battery_Config_t const &config, double capacity_mAh, double press_s, double noise_mV,
+                      bool governed, bool printChanges) {
+    std::mt19937                        rng(1) ;
+    std::normal_distribution<double>    noise(0.0, noise_mV) ;
+    Battery_Governor_t                  governor    = {} ;
+    Battery_Action_t                    action      = BATTERY_ACTION_NONE ;
+    double                              charge_mAh  = capacity_mAh ;
+    double                              lastPress_s = 0.0 ;
+    Run_t                               run         = {} ;
+
+    for (double t = 0.0 ; ; t += BATTERY_PERIOD / 1000.0) {                                     // One governor reading per BATTERY_PERIOD
+        double const load_mA    = action_mA(action) ;
+        double const loaded_mV  = open_circuit_mV(charge_mAh / capacity_mAh) - load_mA * INTERNAL_OHM ;
+        if (loaded_mV <= CUTOFF_MV || charge_mAh <= 0.0) {
+            run.time_s = t ;
+            break ;
+        }
+        bool const pressed = (t - lastPress_s >= press_s) ;
+        if (pressed) {
+            lastPress_s = t ;
+        }
+
+        Battery_Level_t const before = governor.level ;
+        battery_governor_update(&governor, &config, (uint16_t)(loaded_mV + noise(rng))) ;
+        if (!governed) {
+            action = BATTERY_ACTION_NONE ;
+        }
+        else if (pressed || (action != BATTERY_ACTION_LIGHT_SLEEP && action != BATTERY_ACTION_DEEP_SLEEP)) {
+            action = battery_governor_decide(&governor, &config, (uint32_t)((t - lastPress_s) * 1000.0)) ;
+        }                                                                                       // Asleep until the next press otherwise
+        if (printChanges && governor.level != before) {
+            static char const *const names[] = { "NORMAL", "LOW", "CRITICAL" } ;
+            printf("  %8.0f s  %4u mV  %s -> %s\n", t, governor.mV, names[before], names[governor.level]) ;
+        }
+        run.level_s[governor.level] += BATTERY_PERIOD / 1000.0 ;
+        charge_mAh -= action_mA(action) * (BATTERY_PERIOD / 1000.0) / 3600.0 ;
+    }
+    run.transitions = governor.transitions ;
+    return run ;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static bool replay_curve(char const *path, Battery_Config_t const &config) {                   // Open loop: prints level changes only
+    FILE                *file = fopen(path, "r") ;
+    char                 line[128] ;
+    double               time_s ;
+    unsigned             mV ;
+    Battery_Governor_t   governor = {} ;
+    static char const   *const names[] = { "NORMAL", "LOW", "CRITICAL" } ;
+
+    if (file == NULL) {
+        perror(path) ;
+        return false ;
+    }
+    while (fgets(line, sizeof(line), file) != NULL) {
+        if (sscanf(line, "%lf,%u", &time_s, &mV) != 2) {
+            continue ;                                                                          // Header or junk
+        }
+        Battery_Level_t const before = governor.level ;
+        battery_governor_update(&governor, &config, (uint16_t)mV) ;
+        if (governor.level != before) {
+            printf("  %8.0f s  %4u mV  %s -> %s\n", time_s, governor.mV, names[before], names[governor.level]) ;
+        }
+    }
+    fclose(file) ;
+    printf("%u level changes, %u readings out of range\n", governor.transitions, governor.rejected) ;
+    return true ;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int main(int argc, char **argv) {
+    Battery_Config_t    config      = BATTERY_CONFIG_DEFAULT ;
+    double              capacity    = 100.0 ;
+    double              press_s     = 60.0 ;
+    double              noise_mV    = 15.0 ;
+    char const         *curvePath   = NULL ;
+
+    for (int i = 1 ; i < argc ; i += 2) {
+        char const *arg   = argv[i] ;
+        char const *value = (i + 1 < argc) ? argv[i + 1] : NULL ;
+        bool        ok    = (value != NULL) ;
+
+        if      (ok && !strcmp(arg, "--capacity"))      capacity                = atof(value) ;
+        else if (ok && !strcmp(arg, "--press"))         press_s                 = atof(value) ;
+        else if (ok && !strcmp(arg, "--noise"))         noise_mV                = atof(value) ;
+        else if (ok && !strcmp(arg, "--curve"))         curvePath               = value ;
+        else if (ok && !strcmp(arg, "--low"))           config.low_mV           = strtoul(value, NULL, 10) ;
+        else if (ok && !strcmp(arg, "--critical"))      config.critical_mV      = strtoul(value, NULL, 10) ;
+        else if (ok && !strcmp(arg, "--hysteresis"))    config.hysteresis_mV    = strtoul(value, NULL, 10) ;
+        else if (ok && !strcmp(arg, "--filter"))        config.filterShift      = strtoul(value, NULL, 10) ;
+        else ok = false ;
+
+        if (!ok || capacity <= 0.0 || config.critical_mV >= config.low_mV) {
+            fprintf(stderr, "bad argument: %s %s\n", arg, value ? value : "") ;
+            return 2 ;
+        }
+    }
+    if (curvePath != NULL) {
+        return replay_curve(curvePath, config) ? 0 : 1 ;
+    }
+
+    printf("%.0f mAh cell, press every %.0f s, low %u mV, critical %u mV, hysteresis %u mV\n",
+           capacity, press_s, config.low_mV, config.critical_mV, config.hysteresis_mV) ;
+    printf("governed:\n") ;
+    Run_t const governed    = simulate(config, capacity, press_s, noise_mV, true, true) ;
+    Run_t const ungoverned  = simulate(config, capacity, press_s, noise_mV, false, false) ;
+
+    printf("\n%-10s %10s %10s %10s %10s %8s\n", "", "runtime h", "NORMAL h", "LOW h", "CRITICAL h", "changes") ;
+    for (Run_t const *run : { &governed, &ungoverned }) {
+        printf("%-10s %10.2f %10.2f %10.2f %10.2f %8u\n", run == &governed ? "governed" : "ungoverned",
+               run->time_s / 3600.0, run->level_s[0] / 3600.0, run->level_s[1] / 3600.0, run->level_s[2] / 3600.0,
+               run->transitions) ;
+    }
+    return 0 ;
+}
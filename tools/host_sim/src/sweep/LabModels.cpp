@@ -0,0 +1,191 @@
+/*
+ * Name: LabModels
+ * Description: Edge-by-edge replay of each lab's button handling and state
+ *              selection. The debounce arithmetic is kept exactly as written
+ *              in the labs, including previousMillis_Btn += BUTTON_DEBOUNCE
+ *              (which lets a burst through after a long idle) and the uint8_t
+ *              types, because those quirks are what the sweep has to expose.
+ *              Keep these in step with the labs' main.cpp when they change.
+ */
+
+#include "Sweep.h"
+#include <algorithm>
+
+/* Constants */
+static double const SUPPLY_V        = 4.99 ;                                                    // Lab3 power figures
+static double const BOOT_MS         = 300.0 ;                                                   // Deep sleep wake to loop(), at state 0 current
+
+static double const LAB2_MA[5]      = { 63.2, 63.4, 63.3, 0.0, 0.0 } ;                          // Lab2 ISR current readings per state
+static double const LAB3_MA[5]      = { 63.1, 63.8, 63.2, 2.12, 0.012 } ;                       // Lab3 current readings per state
+
+/* Enumerations and Structures */
+typedef struct {                                                                                // Everything one lab run keeps between edges
+    uint8_t     buttonCount ;
+    uint8_t     state ;
+    uint32_t    previousMillis_Btn ;
+    bool        masked ;                                                                        // Lab3 mask-and-rearm: pin masked until the
+    uint64_t    maskedUntil_us ;                                                                // rearm timer fires with the button released
+    bool        pressed ;                                                                       // Pin level after the latest edge
+    uint64_t    bootUntil_us ;                                                                  // Lab3 deep sleep wake in progress
+    uint64_t    stateSince_us ;
+    double      energy_J ;
+} Sim_t ;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/* Function Definitions */
+
+static double blink_duty(Params_t const &params) {                                              // Fraction of time change_to_state2() keeps the
+    uint64_t const  horizon = 200000 ;                                                          // red LED on. OFF fires every BLINK1_DELAY, ON
+    uint64_t        nextOff = params.blink1_ms ;                                                // every BLINK2_DELAY, OFF checked first.
+    uint64_t        nextOn  = params.blink2_ms ;
+    uint64_t        onSince = 0 ;
+    uint64_t        onTotal = 0 ;
+    bool            on      = false ;
+
+    while (std::min(nextOff, nextOn) < horizon) {
+        uint64_t const now = std::min(nextOff, nextOn) ;
+        if (nextOff == now) {
+            if (on) onTotal += now - onSince ;
+            on       = false ;
+            nextOff += params.blink1_ms ;
+        }
+        if (nextOn == now) {
+            if (!on) onSince = now ;
+            on       = true ;
+            nextOn  += params.blink2_ms ;
+        }
+    }
+    if (on) onTotal += horizon - onSince ;
+    return (double)onTotal / horizon ;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static uint8_t select_state(Lab_t lab, uint8_t &buttonCount) {                                  // The if / else if chain at the top of loop()
+    if (lab == LAB3) {
+        if ( !(buttonCount % 7) ) { buttonCount = 0 ; return 0 ; }
+        if ( !(buttonCount % 5) ) return 4 ;
+        if ( !(buttonCount % 3) ) return 3 ;
+        if ( !(buttonCount % 2) ) return 2 ;
+        return 1 ;
+    }
+    if ( !(buttonCount % 3) ) { buttonCount = 0 ; return 0 ; }
+    if ( !(buttonCount % 2) ) return 2 ;
+    return 1 ;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void enter_state(Sim_t &sim, Lab_t lab, double const *power_W, uint64_t time_us) {      // Charges the energy of the state we are leaving
+    sim.energy_J      += power_W[sim.state] * (double)(time_us - sim.stateSince_us) * 1e-6 ;
+    sim.state          = select_state(lab, sim.buttonCount) ;
+    sim.stateSince_us  = time_us ;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static bool handle_edge(Sim_t &sim, Lab_t lab, Params_t const &params, Edge_t const &edge) {    // Returns true when the edge counted as a press
+    uint32_t const currentMillis = (uint32_t)(edge.time_us / 1000) ;
+
+    if (lab == LAB3) {
+        while ( sim.masked && (sim.maskedUntil_us <= edge.time_us) ) {                          // Rearm timer fires: restarted while the button
+            if (sim.pressed) {                                                                  // is still held, unmasked once it is up
+                sim.maskedUntil_us += (uint64_t)params.debounce_ms * 1000 ;
+            }
+            else {
+                sim.masked = false ;
+            }
+        }
+        sim.pressed = (edge.level == 0) ;
+
+        if (edge.time_us < sim.bootUntil_us) {
+            return false ;                                                                      // Still booting after a deep sleep wake
+        }
+        if (sim.state == 4) {                                                                   // ext0 wake on LOW: reboot, buttonCount back to 0
+            if (edge.level != 0) {
+                return false ;
+            }
+            sim.buttonCount     = 0 ;
+            sim.masked          = false ;
+            sim.bootUntil_us    = edge.time_us + (uint64_t)(BOOT_MS * 1000) ;
+            return true ;
+        }
+        if ( (edge.level != 1) || sim.masked ) {                                                // RISING only; masked edges never reach the ISR
+            return false ;
+        }
+        sim.masked          = true ;
+        sim.maskedUntil_us  = edge.time_us + (uint64_t)params.debounce_ms * 1000 ;
+        sim.buttonCount++ ;
+        return true ;
+    }
+
+    uint8_t const actOn = (lab == LAB_ISR) ? 1 : 0 ;                                            // Lab2 ISR attaches RISING like Lab3; Poll sees
+    if (edge.level != actOn) {                                                                  // the falling edge from loop()
+        return false ;
+    }
+    if ( (currentMillis - sim.previousMillis_Btn) >= params.debounce_ms ) {
+        sim.previousMillis_Btn += params.debounce_ms ;
+        sim.buttonCount++ ;
+        return true ;
+    }
+    return false ;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+Result_t lab_simulate(Lab_t lab, Params_t const &params, std::vector<Trace_t> const &traces) {  // Replays every trace with one parameter set
+    double const   *current_mA  = (lab == LAB3) ? LAB3_MA : LAB2_MA ;
+    double          power_W[5] ;
+    double          latencyTotal_ms = 0.0 ;
+    uint32_t        latencyCount    = 0 ;
+    Result_t        result          = {} ;
+
+    result.params = params ;
+    for (int i = 0 ; i < 5 ; i++) {
+        power_W[i] = current_mA[i] * 1e-3 * SUPPLY_V ;
+    }
+    power_W[2] = power_W[0] + (power_W[1] - power_W[0]) * blink_duty(params) ;                  // Red LED costs what the steady blue LED costs
+
+    if ( (lab == LAB_POLL) && (params.debounce_ms > UINT8_MAX) ) {                              // Lab2 Poll declares BUTTON_DEBOUNCE as uint8_t
+        result.invalid = (uint32_t)traces.size() ;
+        return result ;
+    }
+
+    for (Trace_t const &trace : traces) {
+        Sim_t                   sim     = {} ;
+        std::vector<uint64_t>   accepts ;
+
+        for (Edge_t const &edge : trace.edges) {
+            if (handle_edge(sim, lab, params, edge)) {
+                accepts.push_back( (sim.bootUntil_us > edge.time_us) ? sim.bootUntil_us : edge.time_us ) ;
+                enter_state(sim, lab, power_W, edge.time_us) ;
+            }
+        }
+        enter_state(sim, lab, power_W, trace.length_us) ;
+        result.energy_J += sim.energy_J ;
+
+        size_t next = 0 ;                                                                       // Attribute each count to the press window it
+        while ( (next < accepts.size()) && (trace.pressStart_us.empty() || accepts[next] < trace.pressStart_us[0]) ) {
+            result.extra++ ;                                                                    // landed in; counts before any press are bounce.
+            next++ ;
+        }
+        for (size_t p = 0 ; p < trace.pressStart_us.size() ; p++) {
+            uint64_t const  end     = (p + 1 < trace.pressStart_us.size()) ? trace.pressStart_us[p + 1] : UINT64_MAX ;
+            uint32_t        counted = 0 ;
+
+            while ( (next < accepts.size()) && (accepts[next] < end) ) {
+                if (counted == 0) {
+                    double const latency_ms = (double)(accepts[next] - trace.pressStart_us[p]) / 1000.0 ;
+                    latencyTotal_ms       += latency_ms ;
+                    latencyCount++ ;
+                    result.latencyMax_ms   = std::max(result.latencyMax_ms, latency_ms) ;
+                }
+                counted++ ;
+                next++ ;
+            }
+            result.presses++ ;
+            if (counted == 0) result.missed++ ;
+            else              result.extra += counted - 1 ;
+        }
+    }
+
+    result.latencyMean_ms   = latencyCount ? latencyTotal_ms / latencyCount : 0.0 ;
+    result.energy_J        /= traces.empty() ? 1 : traces.size() ;
+    return result ;
+}
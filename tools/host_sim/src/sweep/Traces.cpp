@@ -0,0 +1,87 @@
+/*
+ * Name: Traces
+ * Description: Button press traces for the sweep. Synthetic traces model a
+ *              bouncing contact with a seeded RNG so every run is repeatable;
+ *              recorded traces are "time_us,level" CSV files, e.g. exported
+ *              from a logic analyzer on GPIO 0.
+ */
+
+#include "Sweep.h"
+#include <stdio.h>
+#include <random>
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/* Function Definitions */
+
+static void add_transition(Trace_t &trace, std::mt19937 &rng, Synthetic_t const &config,     // Appends one press or release: the first edge,
+                           uint64_t time_us, uint8_t level) {                                   // then a burst of bounces that settles on level.
+    std::uniform_int_distribution<uint32_t> bounces(0, config.bouncesMax) ;
+    std::uniform_int_distribution<uint32_t> spacing(1, config.bounceMax_us) ;
+    uint32_t const count = bounces(rng) ;
+
+    trace.edges.push_back( {time_us, level} ) ;
+    for (uint32_t i = 0 ; i < count ; i++) {                                                    // Bounce pairs: away from level and back
+        time_us += spacing(rng) ;
+        trace.edges.push_back( {time_us, (uint8_t)!level} ) ;
+        time_us += spacing(rng) ;
+        trace.edges.push_back( {time_us, level} ) ;
+    }
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+Trace_t trace_synthetic(Synthetic_t const &config, uint32_t seed) {                            // Builds config.presses presses with random
+    std::mt19937                            rng(seed) ;                                         // gaps, hold times and bounce bursts.
+    std::uniform_int_distribution<uint32_t> gap(config.gapMin_ms, config.gapMax_ms) ;
+    std::uniform_int_distribution<uint32_t> hold(config.holdMin_ms, config.holdMax_ms) ;
+    Trace_t                                 trace ;
+    uint64_t                                time_us = 0 ;
+
+    trace.name = "synthetic#" + std::to_string(seed) ;
+    for (uint32_t i = 0 ; i < config.presses ; i++) {
+        time_us += (uint64_t)gap(rng) * 1000 ;
+        trace.pressStart_us.push_back(time_us) ;
+        add_transition(trace, rng, config, time_us, 0) ;                                        // Press (active LOW)
+
+        time_us += (uint64_t)hold(rng) * 1000 ;
+        if (time_us <= trace.edges.back().time_us) {                                            // Hold must outlast the press bounce
+            time_us = trace.edges.back().time_us + 1 ;
+        }
+        add_transition(trace, rng, config, time_us, 1) ;                                        // Release
+        time_us = trace.edges.back().time_us ;
+    }
+    trace.length_us = time_us + (uint64_t)config.gapMax_ms * 1000 ;
+    return trace ;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+bool trace_load(char const *path, uint32_t settle_us, Trace_t &trace) {                        // Reads "time_us,level" lines. A falling edge
+    FILE               *file = fopen(path, "r") ;                                               // after settle_us of steady HIGH starts a press.
+    char                line[128] ;
+    unsigned long long  time_us ;
+    unsigned            level ;
+    uint64_t            lastEdge_us = 0 ;
+    uint8_t             lastLevel   = 1 ;
+
+    if (file == NULL) {
+        return false ;
+    }
+    trace.name = path ;
+    while (fgets(line, sizeof(line), file)) {
+        if (sscanf(line, "%llu,%u", &time_us, &level) != 2) {
+            continue ;                                                                          // Header or comment
+        }
+        level = level ? 1 : 0 ;
+        if (level == lastLevel) {
+            continue ;
+        }
+        if ( (level == 0) && (trace.edges.empty() || (time_us - lastEdge_us) >= settle_us) ) {
+            trace.pressStart_us.push_back(time_us) ;
+        }
+        trace.edges.push_back( {(uint64_t)time_us, (uint8_t)level} ) ;
+        lastEdge_us = time_us ;
+        lastLevel   = (uint8_t)level ;
+    }
+    fclose(file) ;
+    trace.length_us = lastEdge_us + 1000000 ;                                                   // One second of idle after the last edge
+    return !trace.edges.empty() ;
+}
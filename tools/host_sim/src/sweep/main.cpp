@@ -0,0 +1,160 @@
+/*
+ * Name: sweep
+ * Description: Parameter sweep for BUTTON_DEBOUNCE, BLINK1_DELAY and BLINK2_DELAY.
+ *              Builds a grid of parameter sets, replays every set against
+ *              every trace on all cores and prints the best configurations.
+ *              Results are ranked by missed + extra presses, then mean
+ *              latency, then energy.
+ * Usage: pio run -e sweep && .pio/build/sweep/program --lab lab3
+ *              --lab poll|isr|lab3          lab to replay (default lab3)
+ *              --debounce MIN:MAX:STEP      ms (default 20:600:10)
+ *              --blink1 MIN:MAX:STEP        ms (default 50:50:1)
+ *              --blink2 MIN:MAX:STEP        ms (default 1000:1000:1)
+ *              --traces N                   synthetic traces (default 200)
+ *              --presses N                  presses per synthetic trace (default 50)
+ *              --trace FILE                 recorded "time_us,level" CSV (repeatable)
+ *              --threads N                  worker threads (default: all cores)
+ *              --top N                      rows to print (default 15)
+ *              --csv FILE                   write every result
+ * Target: Host (PlatformIO native)
+ */
+
+#include "Sweep.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+/* Enumerations and Structures */
+typedef struct {
+    uint32_t    min ;
+    uint32_t    max ;
+    uint32_t    step ;
+} Range_t ;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/* Function Definitions */
+
+static bool parse_range(char const *text, Range_t &range) {                                     // "MIN:MAX:STEP" or a single value
+    unsigned min, max, step ;
+    int const fields = sscanf(text, "%u:%u:%u", &min, &max, &step) ;
+
+    if (fields == 1) { max = min ; step = 1 ; }
+    else if (fields != 3 || step == 0 || max < min) return false ;
+    range = { min, max, step } ;
+    return true ;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static bool better(Result_t const &a, Result_t const &b) {                                      // Ranking: correct first, then fast, then frugal
+    if (a.invalid != b.invalid)                     return a.invalid < b.invalid ;
+    if (a.missed + a.extra != b.missed + b.extra)   return a.missed + a.extra < b.missed + b.extra ;
+    if (a.latencyMean_ms != b.latencyMean_ms)       return a.latencyMean_ms < b.latencyMean_ms ;
+    return a.energy_J < b.energy_J ;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int main(int argc, char **argv) {
+    Lab_t                   lab         = LAB3 ;
+    Range_t                 debounce    = { 20, 600, 10 } ;
+    Range_t                 blink1      = { 50, 50, 1 } ;
+    Range_t                 blink2      = { 1000, 1000, 1 } ;
+    Synthetic_t             synthetic   = { 50, 80, 2000, 40, 400, 12, 800 } ;
+    uint32_t                traceCount  = 200 ;
+    uint32_t                threads     = std::max(1u, std::thread::hardware_concurrency()) ;
+    uint32_t                top         = 15 ;
+    char const             *csvPath     = NULL ;
+    std::vector<Trace_t>    traces ;
+
+    for (int i = 1 ; i < argc ; i++) {
+        char const *arg   = argv[i] ;
+        char const *value = (i + 1 < argc) ? argv[i + 1] : NULL ;
+        bool        ok    = (value != NULL) ;
+
+        if      (ok && !strcmp(arg, "--lab")) {
+            if      (!strcmp(value, "poll"))    lab = LAB_POLL ;
+            else if (!strcmp(value, "isr"))     lab = LAB_ISR ;
+            else if (!strcmp(value, "lab3"))    lab = LAB3 ;
+            else                                ok  = false ;
+        }
+        else if (ok && !strcmp(arg, "--debounce"))  ok = parse_range(value, debounce) ;
+        else if (ok && !strcmp(arg, "--blink1"))    ok = parse_range(value, blink1) ;
+        else if (ok && !strcmp(arg, "--blink2"))    ok = parse_range(value, blink2) ;
+        else if (ok && !strcmp(arg, "--traces"))    traceCount          = strtoul(value, NULL, 10) ;
+        else if (ok && !strcmp(arg, "--presses"))   synthetic.presses   = strtoul(value, NULL, 10) ;
+        else if (ok && !strcmp(arg, "--threads"))   threads             = std::max(1ul, strtoul(value, NULL, 10)) ;
+        else if (ok && !strcmp(arg, "--top"))       top                 = strtoul(value, NULL, 10) ;
+        else if (ok && !strcmp(arg, "--csv"))       csvPath             = value ;
+        else if (ok && !strcmp(arg, "--trace")) {
+            Trace_t trace ;
+            ok = trace_load(value, 20000, trace) ;
+            if (ok) traces.push_back(trace) ;
+        }
+        else ok = false ;
+
+        if (!ok) {
+            fprintf(stderr, "bad argument: %s %s\n", arg, value ? value : "") ;
+            return 2 ;
+        }
+        i++ ;
+    }
+
+    for (uint32_t seed = 1 ; seed <= traceCount ; seed++) {                                     // Recorded traces plus the synthetic set
+        traces.push_back(trace_synthetic(synthetic, seed)) ;
+    }
+
+    std::vector<Params_t> grid ;                                                                // Every combination, BLINK1 inside BLINK2
+    for (uint32_t d = debounce.min ; d <= debounce.max ; d += debounce.step)
+        for (uint32_t b1 = blink1.min ; b1 <= blink1.max ; b1 += blink1.step)
+            for (uint32_t b2 = blink2.min ; b2 <= blink2.max ; b2 += blink2.step)
+                if (b1 <= b2) grid.push_back( {d, b1, b2} ) ;
+
+    std::vector<Result_t>   results(grid.size()) ;                                              // Thread pool: each worker claims the next
+    std::atomic<size_t>     next(0) ;                                                           // parameter set until the grid runs out, so
+    std::vector<std::thread> pool ;                                                             // slow sets never leave a core idle.
+    auto const              start = std::chrono::steady_clock::now() ;
+
+    for (uint32_t t = 0 ; t < threads ; t++) {
+        pool.emplace_back( [&]() {
+            for (size_t job = next++ ; job < grid.size() ; job = next++) {
+                results[job] = lab_simulate(lab, grid[job], traces) ;
+            }
+        } ) ;
+    }
+    for (std::thread &worker : pool) {
+        worker.join() ;
+    }
+    double const elapsed_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() ;
+
+    std::sort(results.begin(), results.end(), better) ;
+    printf("%zu parameter sets x %zu traces = %zu scenarios on %u threads in %.2f s\n\n",
+           grid.size(), traces.size(), grid.size() * traces.size(), threads, elapsed_s) ;
+    printf("%8s %8s %8s | %8s %8s %8s | %10s %10s | %10s\n",
+           "debounce", "blink1", "blink2", "presses", "missed", "extra", "lat mean", "lat max", "energy J") ;
+    for (size_t i = 0 ; i < results.size() && i < top ; i++) {
+        Result_t const &r = results[i] ;
+        if (r.invalid) break ;
+        printf("%8u %8u %8u | %8u %8u %8u | %10.2f %10.2f | %10.3f\n",
+               r.params.debounce_ms, r.params.blink1_ms, r.params.blink2_ms,
+               r.presses, r.missed, r.extra, r.latencyMean_ms, r.latencyMax_ms, r.energy_J) ;
+    }
+
+    if (csvPath != NULL) {
+        FILE *csv = fopen(csvPath, "w") ;
+        if (csv == NULL) {
+            perror(csvPath) ;
+            return 1 ;
+        }
+        fprintf(csv, "debounce_ms,blink1_ms,blink2_ms,presses,missed,extra,invalid,latency_mean_ms,latency_max_ms,energy_J\n") ;
+        for (Result_t const &r : results) {
+            fprintf(csv, "%u,%u,%u,%u,%u,%u,%u,%.3f,%.3f,%.6f\n",
+                    r.params.debounce_ms, r.params.blink1_ms, r.params.blink2_ms,
+                    r.presses, r.missed, r.extra, r.invalid, r.latencyMean_ms, r.latencyMax_ms, r.energy_J) ;
+        }
+        fclose(csv) ;
+    }
+    return 0 ;
+}
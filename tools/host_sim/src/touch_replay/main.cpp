@@ -0,0 +1,222 @@
+/*
+ * Name: touch_replay
+ * Description: Replays touch pad readings through the TouchInput calibration
+ *              and threshold logic. Readings come from recorded CSV files or
+ *              from a simulated pad (slow baseline drift, noise, touches of
+ *              random depth and length). Readings are taken at --interval, as
+ *              the sensor's measurement timer would, and every detected press
+ *              is matched against the labelled touches.
+ * Usage: pio run -e touch_replay && .pio/build/touch_replay/program --interval 20
+ *              --trace FILE            recorded "time_ms,reading[,touched]" CSV (repeatable)
+ *              --synthetic N           simulated traces (default 20, 0 with --trace)
+ *              --interval MS           measurement interval (default 20)
+ *              --threshold PCT         drop that counts as a touch (default 20)
+ *              --hysteresis PCT        release hysteresis (default 5)
+ *              --drift SHIFT           baseline IIR weight 1/2^SHIFT (default 6)
+ *              --cal N                 calibration readings (default 16)
+ *              --events                print every press and release
+ * Target: Host (PlatformIO native)
+ */
+
+#include <TouchInput.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <random>
+#include <string>
+#include <vector>
+
+/* Enumerations and Structures */
+typedef struct {
+    uint32_t    time_ms ;
+    uint16_t    reading ;
+    int8_t      touched ;                                                                       // Label: 1, 0, or -1 when unknown
+} Sample_t ;
+
+typedef struct {
+    std::string             name ;
+    std::vector<Sample_t>   samples ;                                                           // Sorted by time, 1 ms apart when simulated
+} TouchTrace_t ;
+
+typedef struct {
+    uint32_t    touches ;                                                                       // Labelled touches
+    uint32_t    detected ;                                                                      // ... that got a press
+    uint32_t    falsePresses ;                                                                  // Presses outside any labelled touch
+    uint32_t    unlabelled ;                                                                    // Presses in traces without labels
+    double      latencySum_ms ;
+    uint32_t    latencyMax_ms ;
+} Score_t ;
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/* Function Definitions */
+
+static TouchTrace_t trace_simulated(uint32_t seed) {                                            // 60 s at 1 ms: baseline ~900 counts that
+    std::mt19937                            rng(seed) ;                                         // wanders +-10 % over tens of seconds, noise,
+    std::normal_distribution<double>        noise(0.0, 6.0) ;                                   // and touches that pull it down 25-60 %.
+    std::uniform_int_distribution<uint32_t> gap(1500, 6000) ;
+    std::uniform_int_distribution<uint32_t> hold(80, 1200) ;
+    std::uniform_real_distribution<double>  depth(0.25, 0.60) ;
+    std::uniform_real_distribution<double>  phase(0.0, 6.283) ;
+    double const                            driftPhase  = phase(rng) ;
+    TouchTrace_t                            trace ;
+    uint32_t                                nextTouch   = 2000 + gap(rng) ;
+    uint32_t                                touchStart  = 0 ;
+    uint32_t                                touchEnd    = 0 ;
+    double                                  touchDepth  = 0.0 ;
+
+    trace.name = "simulated#" + std::to_string(seed) ;
+    for (uint32_t t = 0 ; t < 60000 ; t++) {
+        if (t == nextTouch) {
+            touchStart  = t ;
+            touchEnd    = t + hold(rng) ;
+            touchDepth  = depth(rng) ;
+            nextTouch   = touchEnd + gap(rng) ;
+        }
+        bool const      touched     = (t < touchEnd) ;
+        double const    baseline    = 900.0 * (1.0 + 0.10 * sin(driftPhase + t / 9000.0)) ;
+        double const    contact     = touched ? std::min(1.0, std::min(t - touchStart + 1, touchEnd - t) / 20.0) : 0.0 ;
+        double          reading     = baseline * (1.0 - touchDepth * contact) + noise(rng) ;    // Finger lands and lifts over ~20 ms
+
+        reading = std::max(1.0, std::min(65535.0, reading)) ;
+        trace.samples.push_back( {t, (uint16_t)reading, (int8_t)touched} ) ;
+    }
+    return trace ;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static bool trace_load(char const *path, TouchTrace_t &trace) {                                 // Reads "time_ms,reading[,touched]" lines;
+    FILE       *file = fopen(path, "r") ;                                                       // anything that does not parse (headers) is
+    char        line[128] ;                                                                     // skipped.
+    unsigned    time_ms, reading ;
+    int         touched ;
+
+    if (file == NULL) {
+        perror(path) ;
+        return false ;
+    }
+    trace.name = path ;
+    while (fgets(line, sizeof(line), file) != NULL) {
+        int const fields = sscanf(line, "%u,%u,%d", &time_ms, &reading, &touched) ;
+        if (fields >= 2) {
+            trace.samples.push_back( {time_ms, (uint16_t)reading, (int8_t)(fields == 3 ? (touched != 0) : -1)} ) ;
+        }
+    }
+    fclose(file) ;
+    return !trace.samples.empty() ;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+static void replay(TouchTrace_t const &trace, Touch_Config_t const &config, uint32_t interval_ms,
+                   bool printEvents, Score_t &score) {
+    Touch_Channel_t channel ;
+    uint32_t        nextSample_ms   = trace.samples.front().time_ms ;
+    uint32_t        touchStart_ms   = 0 ;
+    bool            inTouch         = false ;
+    bool            touchCounted    = false ;
+
+    touch_channel_reset(&channel) ;
+    for (Sample_t const &sample : trace.samples) {
+        if (sample.touched == 1 && !inTouch) {                                                  // Labelled touch begins
+            inTouch         = true ;
+            touchCounted    = false ;
+            touchStart_ms   = sample.time_ms ;
+            score.touches++ ;
+        }
+        else if (sample.touched == 0) {
+            inTouch = false ;
+        }
+        if (sample.time_ms < nextSample_ms) {
+            continue ;
+        }
+        nextSample_ms = sample.time_ms + interval_ms ;
+
+        Touch_Event_t const event = touch_channel_update(&channel, &config, sample.reading) ;
+        if (event == TOUCH_NONE) {
+            continue ;
+        }
+        if (printEvents) {
+            printf("%-16s %8u ms  %-7s reading %5u  baseline %5u  threshold %5u\n", trace.name.c_str(),
+                   sample.time_ms, event == TOUCH_PRESS ? "press" : "release", sample.reading,
+                   touch_channel_baseline(&channel), touch_channel_threshold(&channel, &config)) ;
+        }
+        if (event != TOUCH_PRESS) {
+            continue ;
+        }
+        if (sample.touched < 0) {
+            score.unlabelled++ ;
+        }
+        else if (inTouch && !touchCounted) {
+            uint32_t const latency_ms = sample.time_ms - touchStart_ms ;
+            touchCounted = true ;
+            score.detected++ ;
+            score.latencySum_ms += latency_ms ;
+            score.latencyMax_ms  = std::max(score.latencyMax_ms, latency_ms) ;
+        }
+        else {
+            score.falsePresses++ ;
+        }
+    }
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int main(int argc, char **argv) {
+    Touch_Config_t              config      = TOUCH_CONFIG_DEFAULT ;
+    uint32_t                    interval_ms = 20 ;
+    uint32_t                    synthetic   = 20 ;
+    bool                        synthSet    = false ;
+    bool                        printEvents = false ;
+    std::vector<TouchTrace_t>   traces ;
+
+    for (int i = 1 ; i < argc ; i++) {
+        char const *arg   = argv[i] ;
+        char const *value = (i + 1 < argc) ? argv[i + 1] : NULL ;
+        bool        ok    = (value != NULL) ;
+
+        if (!strcmp(arg, "--events")) {
+            printEvents = true ;
+            continue ;
+        }
+        if      (ok && !strcmp(arg, "--interval"))      interval_ms             = std::max(1ul, strtoul(value, NULL, 10)) ;
+        else if (ok && !strcmp(arg, "--threshold"))     config.thresholdPct     = strtoul(value, NULL, 10) ;
+        else if (ok && !strcmp(arg, "--hysteresis"))    config.hysteresisPct    = strtoul(value, NULL, 10) ;
+        else if (ok && !strcmp(arg, "--drift"))         config.driftShift       = strtoul(value, NULL, 10) ;
+        else if (ok && !strcmp(arg, "--cal"))           config.calSamples       = std::max(1ul, strtoul(value, NULL, 10)) ;
+        else if (ok && !strcmp(arg, "--synthetic")) {
+            synthetic   = strtoul(value, NULL, 10) ;
+            synthSet    = true ;
+        }
+        else if (ok && !strcmp(arg, "--trace")) {
+            TouchTrace_t trace ;
+            ok = trace_load(value, trace) ;
+            if (ok) traces.push_back(trace) ;
+        }
+        else ok = false ;
+
+        if (!ok || config.hysteresisPct >= config.thresholdPct || config.thresholdPct >= 100) {
+            fprintf(stderr, "bad argument: %s %s\n", arg, value ? value : "") ;
+            return 2 ;
+        }
+        i++ ;
+    }
+    if (!traces.empty() && !synthSet) {                                                         // Recorded traces replace the simulated set
+        synthetic = 0 ;                                                                         // unless both are asked for
+    }
+    for (uint32_t seed = 1 ; seed <= synthetic ; seed++) {
+        traces.push_back(trace_simulated(seed)) ;
+    }
+
+    Score_t score = {} ;
+    for (TouchTrace_t const &trace : traces) {
+        replay(trace, config, interval_ms, printEvents, score) ;
+    }
+
+    printf("%zu traces, interval %u ms, threshold %u %%, hysteresis %u %%, drift 1/2^%u, calibration %u readings\n",
+           traces.size(), interval_ms, config.thresholdPct, config.hysteresisPct, config.driftShift, config.calSamples) ;
+    printf("touches %u  detected %u  missed %u  false %u  unlabelled %u\n", score.touches, score.detected,
+           score.touches - score.detected, score.falsePresses, score.unlabelled) ;
+    if (score.detected > 0) {
+        printf("press latency mean %.1f ms  max %u ms\n", score.latencySum_ms / score.detected, score.latencyMax_ms) ;
+    }
+    return (score.falsePresses > 0 || score.detected < score.touches) ? 1 : 0 ;
+}
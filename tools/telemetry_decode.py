@@ -0,0 +1,134 @@
+#!/usr/bin/env python3
+"""
+Name: telemetry_decode.py
+Description: Decodes the framed binary telemetry stream sent by the Telemetry
+             library (Lab3_Low_Power_Modes/lib/Telemetry) into CSV or JSON
+             lines. Frames are COBS encoded, delimited by 0x00 and end with a
+             little-endian CRC-16/CCITT-FALSE over the metrics struct. Frames
+             that fail the CRC or have the wrong length are counted and
+             dropped.
+Usage: telemetry_decode.py /dev/ttyUSB1 --baud 921600            (needs pyserial)
+       telemetry_decode.py capture.bin --format json
+       cat capture.bin | telemetry_decode.py -
+"""
+
+import argparse
+import csv
+import json
+import struct
+import sys
+
+TELEMETRY_VERSION       = 3
+TELEMETRY_WAKE_CAUSES   = 12
+BOOT_TIME_UNKNOWN       = 0xFFFFFFFF
+
+# Mirrors Telemetry_Metrics_t (packed, little-endian)
+METRICS_FORMAT  = "<BBHIIII%dHIIIIIIIIHBB" % TELEMETRY_WAKE_CAUSES
+METRICS_SIZE    = struct.calcsize(METRICS_FORMAT)
+WAKE_NAMES      = ["undefined", "all", "ext0", "ext1", "timer", "touchpad", "ulp",
+                   "gpio", "uart", "wifi", "cocpu", "cocpu_trap"]
+FIELDS          = (["version", "state", "sequence", "uptime_ms", "buttonCount",
+                    "buttonEdgesAccepted", "buttonEdgesSuppressed"]
+                   + ["wake_" + name for name in WAKE_NAMES]
+                   + ["loopCount", "loopMin_us", "loopMax_us", "loopAvg_us"]
+                   + ["bootPreApp_us", "bootAppInit_us", "bootToFirstOutput_us", "bootTotal_us"]
+                   + ["battery_mV", "batteryLevel", "batteryAction"])
+
+
+def crc16(data):
+    crc = 0xFFFF
+    for byte in data:
+        crc ^= byte << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) if crc & 0x8000 else (crc << 1)
+            crc &= 0xFFFF
+    return crc
+
+
+def cobs_decode(data):
+    out = bytearray()
+    i = 0
+    while i < len(data):
+        code = data[i]
+        if code == 0 or i + code > len(data):
+            return None
+        out += data[i + 1:i + code]
+        i += code
+        if code < 0xFF and i < len(data):
+            out.append(0)
+    return bytes(out)
+
+
+def frames(stream):
+    """Yields the raw bytes between 0x00 delimiters."""
+    pending = bytearray()
+    while True:
+        size  = max(1, stream.in_waiting) if hasattr(stream, "in_waiting") else 256                 # Don't stall a live port
+        chunk = stream.read(size)
+        if not chunk:
+            return
+        for byte in chunk:
+            if byte == 0:
+                if pending:
+                    yield bytes(pending)
+                pending = bytearray()
+            else:
+                pending.append(byte)
+
+
+def decode(stream, stats):
+    for raw in frames(stream):
+        payload = cobs_decode(raw)
+        if payload is None or len(payload) != METRICS_SIZE + 2:
+            stats["bad_length"] += 1
+            continue
+        body, crc = payload[:-2], struct.unpack("<H", payload[-2:])[0]
+        if crc16(body) != crc:
+            stats["bad_crc"] += 1
+            continue
+        record = dict(zip(FIELDS, struct.unpack(METRICS_FORMAT, body)))
+        if record["version"] != TELEMETRY_VERSION:
+            stats["bad_version"] += 1
+            continue
+        if record["bootPreApp_us"] == BOOT_TIME_UNKNOWN:                                            # Reset kept the RTC counter running
+            record["bootPreApp_us"] = None
+        stats["ok"] += 1
+        yield record
+
+
+def open_input(name, baud):
+    if name == "-":
+        return sys.stdin.buffer
+    if name.startswith("/dev/") or name.upper().startswith("COM"):
+        import serial
+        return serial.Serial(name, baud, timeout=None)
+    return open(name, "rb")
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Decode Lab3 binary telemetry")
+    parser.add_argument("input", help="serial port, capture file, or - for stdin")
+    parser.add_argument("--baud", type=int, default=921600, help="serial baud rate (TELEMETRY_BAUD)")
+    parser.add_argument("--format", choices=("csv", "json"), default="csv")
+    args = parser.parse_args()
+
+    stats = {"ok": 0, "bad_length": 0, "bad_crc": 0, "bad_version": 0}
+    writer = None
+    try:
+        for record in decode(open_input(args.input, args.baud), stats):
+            if args.format == "json":
+                print(json.dumps(record))
+            else:
+                if writer is None:
+                    writer = csv.DictWriter(sys.stdout, fieldnames=FIELDS)
+                    writer.writeheader()
+                writer.writerow(record)
+            sys.stdout.flush()
+    except KeyboardInterrupt:
+        pass
+    print("frames: %(ok)d ok, %(bad_length)d bad length, %(bad_crc)d bad CRC, "
+          "%(bad_version)d bad version" % stats, file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()